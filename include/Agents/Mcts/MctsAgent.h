@@ -2,8 +2,14 @@
 
 #ifndef MCTSAGENT_H
 #define MCTSAGENT_H
+#include <atomic>
+#include <chrono>
+#include <memory>
 #include "../Agent.h"
+#include "../../Utils/ParallelSearch.h"
 #include "MctsNode.h"
+#include "TranspositionTable.h"
+#include "UctKernel.h"
 #endif
 
 
@@ -21,7 +27,7 @@ namespace Mcts
         int total_forward_calls{};
         int max_depth{};
 
-        std::map<int,gsToNodeMap<MctsNode*>>* layerMap;
+        TranspositionTable* transpositions; //Only used in the DAG mode
 
         //For global std exploration factor
         std::vector<double> total_squared_v;
@@ -33,6 +39,11 @@ namespace Mcts
         bool determ_var_reduction=false;
         std::vector<int> layer_seeds;
         int determinization_salt;
+
+        //Shared tree only: Guards the global statistics above, while every node is guarded by its own mutex
+        std::mutex* shared_tree_mutex = nullptr;
+
+        POOL::TreeArena* arena = nullptr; //Holds the nodes and states of the searched tree
     };
 
     struct MctsArgs
@@ -54,6 +65,12 @@ namespace Mcts
         bool puct = false; //If true, use PUCT instead of UCT
 
         bool greedy_decision_policy = true;
+
+        //Parallel search, requires a model that implements clone
+        int threads = 1;
+        bool leaf_parallel = false; //If false, every thread searches its own tree and the root statistics are merged (root parallelization). If true, the threads play the num_rollouts rollouts of each leaf instead (leaf parallelization)
+        bool shared_tree = false; //If true, the threads instead search one shared tree (tree parallelization)
+        double virtual_loss = 1.0; //Shared tree only: in-flight actions count one more visit whose value is this much lower
     };
 
     class MctsAgent final : public Agent
@@ -62,13 +79,24 @@ namespace Mcts
         explicit MctsAgent(const MctsArgs& args);
         int getAction(ABS::Model* model, ABS::Gamestate* state, std::mt19937& rng) override;
         MctsNode* buildTree(ABS::Model* model, ABS::Gamestate* state, MctsSearchStats& search_stats, std::mt19937& rng, bool determinize_env = false, bool determ_var_reduction = false);
-        void cleanupTree(MctsNode* root);
+        void cleanupTree(); //Frees all trees built since the last cleanup at once
+
+        static void runTests();
 
     private:
+        MctsNode* buildTree(ABS::Model* model, ABS::Gamestate* state, MctsSearchStats& search_stats, std::mt19937& rng, const MctsBudget& tree_budget,
+                            std::chrono::high_resolution_clock::time_point start, std::atomic<long>* shared_forward_calls, POOL::TreeArena& arena, PARALLEL::RolloutScratch& scratch,
+                            bool determinize_env, bool determ_var_reduction);
+        int getRootParallelAction(ABS::Model* model, ABS::Gamestate* state, std::mt19937& rng);
+        int getSharedTreeAction(ABS::Model* model, ABS::Gamestate* state, std::mt19937& rng);
+        int selectMergedAction(const std::vector<MctsNode*>& roots, std::mt19937& rng) const;
+
         std::vector<std::tuple<MctsNode*,int,std::vector<double>>> treePolicy(ABS::Model* model, MctsNode* node, std::mt19937& rng, MctsSearchStats& search_stats);
-        MctsNode* selectNode(ABS::Model* model, MctsNode* node, bool& reached_leaf, int &chosen_action, std::vector<double>& rewards, std::mt19937& rng, MctsSearchStats& search_stats);
+        // Path entries and the action selection below refer to actions by their index in the tried actions of the node
+        MctsNode* selectNode(ABS::Model* model, MctsNode* node, bool& reached_leaf, int &chosen_idx, std::vector<double>& rewards, std::mt19937& rng, MctsSearchStats& search_stats);
         int selectAction(MctsNode* node, bool greedy, std::mt19937& rng, MctsSearchStats& search_stats);
-        std::vector<double> rollout(ABS::Model* model, MctsNode* node, std::mt19937& rng) const;
+        std::vector<double> rollout(ABS::Model* model, MctsNode* node, std::mt19937& rng, PARALLEL::RolloutScratch& scratch);
+        void playRollout(ABS::Model* model, const MctsNode* node, std::mt19937& rng, double* reward_sum, PARALLEL::RolloutScratch& scratch) const;
         void backup(std::vector<double> values, std::vector<std::tuple<MctsNode*,int,std::vector<double>>>& path, MctsSearchStats& search_stats) const;
         int sampleAction(MctsNode* node,std::mt19937& rng);
 
@@ -84,7 +112,20 @@ namespace Mcts
         double a,b;
         bool puct;
         bool greedy_decision_policy;
+        int threads;
+        bool leaf_parallel;
+        bool shared_tree;
+        double virtual_loss;
         constexpr static double TIEBREAKER_NOISE = 1e-6;
+
+        //Leaf parallelization, with one model clone per pool thread while searching
+        std::unique_ptr<PARALLEL::RolloutPool> rollout_pool;
+
+        //One arena per tree that is searched at the same time, its chunks are reused by the following searches
+        std::vector<std::unique_ptr<POOL::TreeArena>> arenas;
+
+        //Rollout memory of each thread that searches, reused by all its rollouts
+        std::vector<PARALLEL::RolloutScratch> rollout_scratches;
     };
 
 }
\ No newline at end of file
@@ -2,11 +2,15 @@
 
 #ifndef MCTSNODE_H
 #define MCTSNODE_H
+#include <atomic>
 #include <map>
+#include <memory_resource>
+#include <mutex>
 #include <random>
 #include <unordered_set>
 #include <vector>
 #include "../../Arena.h"
+#include "../../Utils/NodePool.h"
 
 namespace Mcts
 {
@@ -25,9 +29,12 @@ namespace Mcts
     class MctsNode;
 
     template<class T>
-    using gsToNodeMap = std::unordered_map<ABS::Gamestate*, T, GSHash, GSCompare>;
+    using gsToNodeMap = std::pmr::unordered_map<ABS::Gamestate*, T, GSHash, GSCompare>;
 
-    inline long global_id = 0;
+    // Copy of state in arena, constructed in place if the model supports it
+    ABS::Gamestate* copyStateToArena(ABS::Model* model, ABS::Gamestate* state, POOL::TreeArena& arena);
+
+    inline std::atomic<long> global_id = 0; //Atomic, as parallel searches create nodes concurrently
 
     class MctsNode
     {
@@ -37,30 +44,49 @@ namespace Mcts
             ABS::Model* model,
             ABS::Gamestate* state,
             int depth,
-            std::mt19937& rng
+            std::mt19937& rng,
+            std::pmr::memory_resource* memory //Of all containers of the node, usually the arena of its tree
         );
 
+        // Moves an untried action to the tried actions and returns its index, which addresses all per-action stats below
         int popUntriedAction(double vinit);
 
         void addVisit();
-        void addActionVisit(int action);
-        void addActionValues(int action, const std::vector<double>& values, bool max_backup);
-
-        [[nodiscard]] std::vector<double>* getActionValues(int action);
+        void addActionVisit(int idx);
+        void addActionValues(int idx, const std::vector<double>& values, bool max_backup);
+
+        // Shared tree: An in-flight action counts one more visit, with loss subtracted from the value of the acting player.
+        // Virtual losses are kept apart from the real stats, only the action selection adds them in.
+        void addVirtualLoss(int idx, double loss);
+        void removeVirtualLoss(int idx, double loss);
+        [[nodiscard]] int getVirtualVisits() const { return virtual_visits; }
+        [[nodiscard]] const int* getAllActionVirtualVisits() const { return action_virtual_visits.data(); }
+        [[nodiscard]] const double* getAllActionVirtualValues() const { return action_virtual_values.data(); } //One value per action, of the acting player
+        [[nodiscard]] std::mutex& getMutex() { return mutex; } //Guards the stats and children of the node when searching a shared tree
+
+        // Values of all players for the tried action idx
+        [[nodiscard]] const double* getActionValues(int idx) const { return &action_values[idx * num_players]; }
+        [[nodiscard]] int getActionVisits(int idx) const { return action_visits[idx]; }
+        [[nodiscard]] int getTriedAction(int idx) const { return tried_actions[idx]; }
+        [[nodiscard]] int getNumTriedActions() const { return static_cast<int>(tried_actions.size()); }
+        [[nodiscard]] const int* getAllActionVisits() const { return action_visits.data(); }
+        [[nodiscard]] const double* getAllActionValues() const { return action_values.data(); }
+        [[nodiscard]] int getNumPlayers() const { return num_players; }
+        [[nodiscard]] gsToNodeMap<MctsNode*>& getChildren(int idx) { return children[idx]; }
 
         [[nodiscard]] ABS::Model* getModel() const;
         [[nodiscard]] ABS::Gamestate* getStateCopy() const;
+        [[nodiscard]] ABS::Gamestate* getStateCopy(ABS::Model* model) const; //Copy made by another model, e.g. a clone used by another thread
+        [[nodiscard]] ABS::Gamestate* getStateCopy(ABS::Model* model, POOL::TreeArena& arena) const;
         [[nodiscard]] const ABS::Gamestate* getState() const;
-        [[nodiscard]] std::map<int, gsToNodeMap<MctsNode*>>* getChildren();
         [[nodiscard]] int getPlayer() const;
 
 
         [[nodiscard]] int getDepth() const;
         [[nodiscard]] int getVisits() const;
-        [[nodiscard]] int getActionVisits(int action);
         [[nodiscard]] bool isFullyExpanded() const;
         [[nodiscard]] bool isTerminal() const;
-        [[nodiscard]] std::vector<int>* getTriedActions();
+        [[nodiscard]] const std::pmr::vector<int>& getTriedActions() const;
 
         ~MctsNode() = default;
 
@@ -70,15 +96,25 @@ namespace Mcts
         // Model related stats
         ABS::Model* model;
         ABS::Gamestate* state;
-        std::map<int, gsToNodeMap<MctsNode*>> children;
+        int num_players;
 
         // MCTS stats
         int depth;
         int visits;
-        std::map<int, int> action_visits;
-        std::map<int, std::vector<double>> action_values;
-        std::vector<int> tried_actions;
-        std::vector<int> untried_actions;
+        int virtual_visits = 0;
+
+        // Per-action stats as parallel arrays, indexed by the position of the action in tried_actions.
+        // All are reserved for the available actions of the node, so they never reallocate.
+        std::pmr::vector<int> tried_actions;
+        std::pmr::vector<int> action_visits;
+        std::pmr::vector<double> action_values; //num_players values per action
+        std::pmr::vector<int> action_virtual_visits;
+        std::pmr::vector<double> action_virtual_values;
+        std::pmr::vector<gsToNodeMap<MctsNode*>> children;
+
+        std::mutex mutex;
+
+        std::pmr::vector<int> untried_actions;
     };
 
 }
@@ -0,0 +1,55 @@
+#pragma once
+
+#ifndef TRANSPOSITIONTABLE_H
+#define TRANSPOSITIONTABLE_H
+#include <array>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include "MctsNode.h"
+#endif
+
+namespace Mcts
+{
+
+    /*
+     * Nodes of the DAG mode, keyed by depth and state. The table is split into shards by the hash of the key and each shard has
+     * its own mutex, so that threads searching a shared tree rarely wait for each other.
+     */
+    class TranspositionTable
+    {
+    private:
+        using Key = std::pair<int, ABS::Gamestate*>;
+
+        struct KeyHash {
+            size_t operator()(const Key& key) const {
+                return GSHash()(key.second) * 31 + key.first;
+            }
+        };
+
+        struct KeyCompare {
+            bool operator()(const Key& lhs, const Key& rhs) const {
+                return lhs.first == rhs.first && GSCompare()(lhs.second, rhs.second);
+            }
+        };
+
+        struct Shard {
+            std::mutex mutex;
+            std::unordered_map<Key, MctsNode*, KeyHash, KeyCompare> nodes;
+        };
+
+        constexpr static size_t NUM_SHARDS = 64;
+        std::array<Shard, NUM_SHARDS> shards{};
+
+        Shard& getShard(const Key& key) { return shards[KeyHash()(key) % NUM_SHARDS]; }
+
+    public:
+        // nullptr if no node of the state is stored at this depth
+        [[nodiscard]] MctsNode* find(int depth, ABS::Gamestate* state);
+
+        // Stores node for the state unless another node is already stored, and returns the stored node.
+        // The key refers to state, which therefore has to live as long as the table.
+        MctsNode* insert(int depth, ABS::Gamestate* state, MctsNode* node);
+    };
+
+}
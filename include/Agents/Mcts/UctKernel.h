@@ -0,0 +1,52 @@
+#pragma once
+
+#ifndef UCTKERNEL_H
+#define UCTKERNEL_H
+#include <cstdint>
+#endif
+
+namespace Mcts
+{
+
+    struct UctScoreParams
+    {
+        bool puct = false; //Exploration term sqrt(N) / (1 + n) instead of sqrt(log(N) / n)
+        bool greedy = false; //Score is only the q value
+        bool uniform = false; //Score is only the exploration term
+        double numerator = 0; //sqrt(N) for PUCT, log(N) for UCT
+        double exploration_factor = 1; //Weight of the exploration term
+        bool max_backup = false; //Values are maxima instead of sums, i.e. they are not divided by the visits
+        uint32_t noise_key = 0; //Seed of the tiebreak noise, drawn once per selection
+        double noise_scale = 0;
+    };
+
+    /*
+     * Returns the index of the action with the highest UCT/PUCT score, or -42 if no score is larger than -infinity.
+     * visits holds the visits of num_actions actions, values their num_players values each, of which the one of player is used.
+     * If virtual_visits is not nullptr, the virtual losses of a shared tree, virtual_visits and virtual_values (one value per action,
+     * of player), are added to the statistics.
+     * Uses an AVX2 implementation if the CPU supports it and a scalar one otherwise, both give bit-identical results.
+     */
+    int selectBestAction(const int* visits, const double* values, const int* virtual_visits, const double* virtual_values, int num_players, int player, int num_actions, const UctScoreParams& params);
+
+    // The implementations behind selectBestAction, exposed for testing. selectBestActionAvx2 may only be called if hasAvx2() holds.
+    int selectBestActionScalar(const int* visits, const double* values, const int* virtual_visits, const double* virtual_values, int num_players, int player, int num_actions, const UctScoreParams& params);
+#if defined(__x86_64__) || defined(__i386__)
+    __attribute__((target("avx2")))
+    int selectBestActionAvx2(const int* visits, const double* values, const int* virtual_visits, const double* virtual_values, int num_players, int player, int num_actions, const UctScoreParams& params);
+    bool hasAvx2();
+#endif
+
+    // Counter-based tiebreak noise in [-1,1) for the action with index idx, so that it can be computed for several actions at once
+    inline double tiebreakNoise(uint32_t key, const uint32_t idx)
+    {
+        key += idx * 0x9e3779b9U;
+        key ^= key >> 16;
+        key *= 0x7feb352dU;
+        key ^= key >> 15;
+        key *= 0x846ca68bU;
+        key ^= key >> 16;
+        return static_cast<int32_t>(key) * 0x1p-31;
+    }
+
+}
@@ -1,12 +1,21 @@
 #ifndef OGAABSTRACTNODES_H
 #define OGAABSTRACTNODES_H
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <ranges>
 #include <set>
+#include <vector>
 
 #include "OgaAgent.h"
 #include "OgaGroundNodes.h"
 
 namespace OGA {
 
+    template <class T> class CountBucketSet;
+
     class OgaAbstractNode
     {
     private:
@@ -15,6 +24,12 @@ namespace OGA {
         unsigned id;
         unsigned depth;
 
+        // Intrusive membership in the CountBucketSet of its depth
+        template <class T> friend class CountBucketSet;
+        constexpr static unsigned NO_BUCKET = std::numeric_limits<unsigned>::max();
+        unsigned bucket = NO_BUCKET; //count under which the node is filed
+        size_t bucket_position = 0;
+
     protected:
         OgaAbstractNode(const unsigned depth, unsigned id) : id(id), depth(depth) {}
         void increaseCount();
@@ -32,10 +47,191 @@ namespace OGA {
         [[nodiscard]] size_t hash() const;
     };
 
+    /*
+     * Set of the abstract nodes of one depth, ordered by count ascending and then by id descending (the order of AbsQCompare/AbsStateCompare).
+     * Nodes are kept in one bucket per count and store their bucket position themselves, so insert and erase are O(1) without allocations.
+     * Within a bucket the id order is only established (by sorting) when an ordered access requires it.
+     * The count of a node must not change while it is contained, i.e. it has to be erased before and reinserted after a transfer.
+     */
+    template <class T>
+    class CountBucketSet
+    {
+    private:
+        struct Bucket{
+            std::vector<T*> nodes{};
+            bool sorted = true; //nodes are ordered by id descending
+        };
+
+        std::vector<Bucket> buckets{}; //indexed by count
+        std::vector<unsigned> counts{}; //counts of the non-empty buckets, ascending
+        size_t num_nodes = 0;
+
+        static OgaAbstractNode* base(T* node) { return node; }
+        static const OgaAbstractNode* base(const T* node) { return node; }
+
+        Bucket& sortedBucket(unsigned count) {
+            Bucket& bucket = buckets[count];
+            if (!bucket.sorted) {
+                std::sort(bucket.nodes.begin(), bucket.nodes.end(), [](const T* lhs, const T* rhs) { return lhs->getId() > rhs->getId(); });
+                for (size_t i = 0; i < bucket.nodes.size(); i++)
+                    base(bucket.nodes[i])->bucket_position = i;
+                bucket.sorted = true;
+            }
+            return bucket;
+        }
+
+    public:
+        CountBucketSet() = default;
+        CountBucketSet(const CountBucketSet&) = delete;
+        CountBucketSet& operator=(const CountBucketSet&) = delete;
+        CountBucketSet(CountBucketSet&&) noexcept = default;
+        CountBucketSet& operator=(CountBucketSet&&) noexcept = default;
+
+        void insert(T* node) {
+            OgaAbstractNode* b = base(node);
+            assert (b->bucket == OgaAbstractNode::NO_BUCKET);
+            const unsigned count = node->getCount();
+            if (buckets.size() <= count)
+                buckets.resize(count + 1);
+            Bucket& bucket = buckets[count];
+            if (bucket.nodes.empty())
+                counts.insert(std::lower_bound(counts.begin(), counts.end(), count), count);
+            else if (bucket.sorted && bucket.nodes.back()->getId() < node->getId())
+                bucket.sorted = false;
+            b->bucket = count;
+            b->bucket_position = bucket.nodes.size();
+            bucket.nodes.push_back(node);
+            num_nodes++;
+        }
+
+        // Does nothing if the node is not contained
+        void erase(T* node) {
+            OgaAbstractNode* b = base(node);
+            if (b->bucket == OgaAbstractNode::NO_BUCKET)
+                return;
+            Bucket& bucket = buckets[b->bucket];
+            assert (bucket.nodes[b->bucket_position] == node);
+            if (b->bucket_position + 1 != bucket.nodes.size()) {
+                T* moved = bucket.nodes.back();
+                bucket.nodes[b->bucket_position] = moved;
+                base(moved)->bucket_position = b->bucket_position;
+                bucket.sorted = false;
+            }
+            bucket.nodes.pop_back();
+            if (bucket.nodes.empty()) {
+                counts.erase(std::lower_bound(counts.begin(), counts.end(), b->bucket));
+                bucket.sorted = true;
+            }
+            b->bucket = OgaAbstractNode::NO_BUCKET;
+            num_nodes--;
+        }
+
+        [[nodiscard]] bool contains(const T* node) const {
+            const unsigned count = base(node)->bucket;
+            return count != OgaAbstractNode::NO_BUCKET && count < buckets.size() && base(node)->bucket_position < buckets[count].nodes.size()
+                && buckets[count].nodes[base(node)->bucket_position] == node;
+        }
+
+        [[nodiscard]] size_t size() const { return num_nodes; }
+        [[nodiscard]] bool empty() const { return num_nodes == 0; }
+
+        // The k-th node in set order
+        T* at(size_t k) {
+            assert (k < num_nodes);
+            for (const unsigned count : counts) {
+                if (k < buckets[count].nodes.size())
+                    return sortedBucket(count).nodes[k];
+                k -= buckets[count].nodes.size();
+            }
+            return nullptr;
+        }
+
+        // All nodes in reverse set order, i.e. largest count first and ties by smaller id
+        std::vector<T*> descending() {
+            std::vector<T*> nodes;
+            nodes.reserve(num_nodes);
+            for (const unsigned count : std::ranges::reverse_view(counts)) {
+                const auto& bucket_nodes = sortedBucket(count).nodes;
+                nodes.insert(nodes.end(), bucket_nodes.rbegin(), bucket_nodes.rend());
+            }
+            return nodes;
+        }
+
+        // Visits all nodes, by count ascending but in no particular order within a count
+        template <class F>
+        void forEach(F&& f) const {
+            for (const unsigned count : counts)
+                for (T* node : buckets[count].nodes)
+                    f(node);
+        }
+    };
+
+    /*
+     * The ground nodes of an abstract node. Every member stores its position in the list itself, so membership tests, insertion and
+     * removal are O(1). The member with minimal id (used as representant for reproducibility) is tracked by a min-heap
+     * whose entries of nodes that left the list are only discarded when they reach the top.
+     */
+    template <class Node>
+    class GroundNodeList
+    {
+    private:
+        using HeapEntry = std::pair<unsigned, Node*>; //id, node
+        std::vector<Node*> nodes{};
+        mutable std::vector<HeapEntry> id_heap{}; //entries of removed nodes are discarded lazily, also by const lookups
+
+        void rebuildHeap() {
+            id_heap.clear();
+            for (Node* node : nodes)
+                id_heap.emplace_back(node->getId(), node);
+            std::make_heap(id_heap.begin(), id_heap.end(), std::greater<>{});
+        }
+
+    public:
+        using Iterator = typename std::vector<Node*>::const_iterator;
+
+        void insert(Node* node) {
+            assert (!contains(node));
+            node->setAbstractPosition(nodes.size());
+            nodes.push_back(node);
+            if (id_heap.size() > 2 * nodes.size() + 16)
+                rebuildHeap();
+            else {
+                id_heap.emplace_back(node->getId(), node);
+                std::push_heap(id_heap.begin(), id_heap.end(), std::greater<>{});
+            }
+        }
+
+        void erase(Node* node) {
+            assert (contains(node));
+            const size_t position = node->getAbstractPosition();
+            nodes[position] = nodes.back();
+            nodes[position]->setAbstractPosition(position);
+            nodes.pop_back();
+        }
+
+        [[nodiscard]] bool contains(const Node* node) const {
+            return node->getAbstractPosition() < nodes.size() && nodes[node->getAbstractPosition()] == node;
+        }
+
+        // Member with minimal id, nullptr if empty
+        Node* minIdNode() const {
+            while (!id_heap.empty() && !contains(id_heap.front().second)) {
+                std::pop_heap(id_heap.begin(), id_heap.end(), std::greater<>{});
+                id_heap.pop_back();
+            }
+            return id_heap.empty() ? nullptr : id_heap.front().second;
+        }
+
+        [[nodiscard]] size_t size() const { return nodes.size(); }
+        [[nodiscard]] bool empty() const { return nodes.empty(); }
+        Node* operator[](size_t i) const { return nodes[i]; }
+        [[nodiscard]] Iterator begin() const { return nodes.begin(); }
+        [[nodiscard]] Iterator end() const { return nodes.end(); }
+    };
+
     // Forward declaration
     class OgaAbstractStateNode;
-    struct AbsStateCompare;
-    using AbsStateSet = std::set<OgaAbstractStateNode*, AbsStateCompare>;
+    using AbsStateSet = CountBucketSet<OgaAbstractStateNode>;
 
     class OgaAbstractStateNode : public OgaAbstractNode
     {
@@ -49,28 +245,31 @@ namespace OGA {
         void remove(OgaStateNode* state_node);
         [[nodiscard]] OgaStateNode* getRepresentant() const;
         void setRepresentant(OgaStateNode* representant);
-        std::set<OgaStateNode*>& getGroundNodes() { return ground_nodes; }
+        [[nodiscard]] const GroundNodeList<OgaStateNode>& getGroundNodes() const { return ground_nodes; }
 
     private:
         OgaStateNode* representant = nullptr; //only needed when eps_a > 0 or eps_t > 0
-        std::set<OgaStateNode*> ground_nodes;
+        GroundNodeList<OgaStateNode> ground_nodes;
     };
 
 
     // Forward declaration
     class OgaAbstractQStateNode;
-    struct AbsQCompare;
-    using AbsQSet = std::set<OgaAbstractQStateNode*, AbsQCompare>;
+    using AbsQSet = CountBucketSet<OgaAbstractQStateNode>;
 
     class OgaAbstractQStateNode : public OgaAbstractNode
     {
     private:
         OgaQStateNode * representant = nullptr; //only needed when eps_a or eps_t > 0
-        std::set<OgaQStateNode*> ground_nodes;
+        GroundNodeList<OgaQStateNode> ground_nodes;
 
         double values = 0;
         double visits = 0;
         double squared_values = 0; //only needed for std calculation for OGA-CAD (abs dropping)
+        double virtual_values = 0; //Virtual losses of the ground nodes, apart from the real statistics
+        double virtual_visits = 0;
+
+        std::mutex mutex;
 
     public:
         using OgaAbstractNode::OgaAbstractNode;
@@ -82,7 +281,12 @@ namespace OGA {
         [[nodiscard]] OgaQStateNode* getRepresentant() const;
         void setRepresentant(OgaQStateNode* representant);
         void addExperience(double values);
-        std::set<OgaQStateNode*>& getGroundNodes() { return ground_nodes; }
+        void addVirtualLoss(double value) { virtual_values += value; virtual_visits++; }
+        void removeVirtualLoss(double value) { virtual_values = --virtual_visits == 0? 0 : virtual_values - value; }
+        [[nodiscard]] double getVirtualValues() const { return virtual_values; }
+        [[nodiscard]] double getVirtualVisits() const { return virtual_visits; }
+        [[nodiscard]] std::mutex& getMutex() { return mutex; } //Guards the statistics when searching a shared tree, the ground nodes only change in abstraction updates
+        [[nodiscard]] const GroundNodeList<OgaQStateNode>& getGroundNodes() const { return ground_nodes; }
 
         static void transfer(OgaQStateNode* q_state_node, OgaAbstractQStateNode* from, OgaAbstractQStateNode* to, AbsQSet& abs_q_set, OgaBehaviorFlags& flags);
         void add(OgaQStateNode* q_state_node, OgaBehaviorFlags& flags);
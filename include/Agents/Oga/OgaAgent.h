@@ -3,10 +3,16 @@
 
 #ifndef OGAAGENT_H
 #define OGAAGENT_H
+#include <atomic>
+#include <chrono>
 #include <map>
+#include <memory>
+#include <mutex>
 
 #include "OgaGroundNodes.h"
+#include "OgaTelemetry.h"
 #include "../../Utils/ValueIteration.h"
+#include "../../Utils/ParallelSearch.h"
 #include "../Agent.h"
 #endif
 
@@ -33,8 +39,17 @@ namespace OGA
         double total_squared_v{};
         double total_v{};
         int global_num_vs = 0;
+
+        //Shared tree only: Guards the statistics above and the node sets of the tree, while every node is guarded by its own mutex
+        std::mutex* shared_tree_mutex = nullptr;
+
+#ifdef OGA_TELEMETRY
+        OgaTelemetry telemetry{};
+#endif
     };
 
+    enum class InAbsPolicy {RANDOM, RANDOM_GREEDY, UCT, LEAST_OUTCOMES, FIRST, GREEDY, LEAST_VISITS, MOST_VISITS};
+
     struct OgaArgs
     {
         OgaBudget budget;
@@ -43,6 +58,14 @@ namespace OGA
         double discount = 1.0;
         int num_rollouts = 1;
         int rollout_length = -1;
+        int rollout_threads = 1; //Number of threads that play the num_rollouts rollouts of a leaf, each on its own model clone
+        int threads = 1; //Number of root-parallel searches, each with its own tree and model clone. Their root statistics are merged
+        bool shared_tree = false; //If true, the threads instead search one shared tree (tree parallelization)
+        double virtual_loss = 1.0; //Shared tree only: in-flight q nodes count one more visit whose value is this many global stds below their mean
+        int abs_update_interval = 1; //Abstractions are updated in one batch every abs_update_interval iterations (and once more at the end of a search)
+        unsigned abs_update_threshold = 0; //If > 0, a batch is also updated as soon as this many nodes are staged
+        bool reuse_tree = false; //If true, the search continues on the subtree of the previous decision's tree that belongs to the current state
+        size_t max_tree_nodes = 0; //Memory bound: If > 0, the tree stops growing once it holds this many state and q nodes, iterations then only select within it
         OgaBehaviorFlags behavior_flags;
 
         /*
@@ -54,6 +77,9 @@ namespace OGA
 
         //Only optionally needed when tracking statistics
         bool track_statistics = false;
+
+        //Per decision telemetry (requires compiling with OGA_TELEMETRY). Lines are appended as CSV, or as JSON lines if the file ends with .json
+        std::string telemetry_file = "";
         std::unordered_map<std::pair<FINITEH::Gamestate*,int> , double, VALUE_IT::QMapHash, VALUE_IT::QMapCompare>* Q_map = nullptr;
         Agent* distribution_agent = nullptr;
 
@@ -63,25 +89,51 @@ namespace OGA
     class OgaAgent final : public Agent
     {
     private:
+        [[nodiscard]] bool abstractionUpdateDue(const OgaTree* tree, int completed_iterations) const;
+        void search(OgaTree* tree, ABS::Model* model, OgaSearchStats& search_stats, std::mt19937& rng, std::chrono::high_resolution_clock::time_point start,
+                    std::atomic<long>* shared_forward_calls, PARALLEL::RolloutScratch& scratch);
+        int getRootParallelAction(ABS::Model* model, ABS::Gamestate* state, std::mt19937& rng, OgaTree** treePtr);
+        int getSharedTreeAction(ABS::Model* model, ABS::Gamestate* state, std::mt19937& rng, OgaTree** treePtr);
+        int selectMergedAction(const std::vector<OgaTree*>& trees, std::mt19937& rng) const;
+
+        OgaTree* reuseTree(ABS::Model* model, ABS::Gamestate* state, OgaSearchStats& search_stats, std::mt19937& rng);
+
         OgaStateNode* selectSuccessorState(OgaTree* tree, OgaStateNode* node, ABS::Model* model, OgaSearchStats& search_stats, std::mt19937& rng,
-                                           bool* new_state);
-        OgaStateNode* treePolicy(OgaTree* tree, ABS::Model* model, OgaSearchStats& search_stats, std::mt19937& rng);
+                                           bool* new_state, std::vector<OgaQStateNode*>& trajectory);
+        OgaStateNode* treePolicy(OgaTree* tree, ABS::Model* model, OgaSearchStats& search_stats, std::mt19937& rng, std::vector<OgaQStateNode*>& trajectory);
 
-        std::vector<double> rollout(const OgaStateNode* leaf, ABS::Model* model, std::mt19937& rng) const;
+        [[nodiscard]] bool treeFull(const OgaTree* tree) const; //In a shared tree, only while holding the shared_tree_mutex
+        std::vector<double> rollout(const OgaStateNode* leaf, ABS::Model* model, std::mt19937& rng, PARALLEL::RolloutScratch& scratch);
+        void playRollout(const OgaStateNode* leaf, ABS::Model* model, std::mt19937& rng, double* reward_sum, PARALLEL::RolloutScratch& scratch) const;
 
-        void backup(OgaTree* tree, OgaStateNode* leaf, std::vector<double> values, OgaSearchStats& search_stats) const;
-        int selectAction(ABS::Model* model, OgaStateNode* node, bool greedy, OgaSearchStats& search_stats, std::mt19937& rng);
+        void backup(OgaTree* tree, const std::vector<OgaQStateNode*>& trajectory, std::vector<double> values, OgaSearchStats& search_stats) const;
+        int selectAction(OgaTree* tree, ABS::Model* model, OgaStateNode* node, bool greedy, OgaSearchStats& search_stats, std::mt19937& rng);
+        template <InAbsPolicy POLICY>
+        int selectAction(OgaTree* tree, OgaStateNode* node, bool greedy, OgaSearchStats& search_stats, std::mt19937& rng);
 
         double exploration_parameter;
         double discount;
         int num_rollouts;
         int rollout_length;
+        int threads;
+        bool shared_tree;
         unsigned recency_count_limit;
         OgaBudget budget;
         const OgaArgs args;
+        OgaBehaviorFlags behavior_flags; //args.behavior_flags with resolved abstraction algorithms
+
+        //Batched rollouts, with one model clone per pool thread while searching
+        std::unique_ptr<PARALLEL::RolloutPool> rollout_pool;
+
+        //Rollout memory of each thread that searches, reused by all its rollouts
+        std::vector<PARALLEL::RolloutScratch> rollout_scratches;
+
+        //Tree reuse
+        OgaTree* previous_tree = nullptr;
+        int previous_action = -1;
 
         //In abs decision policies
-        std::string in_abs_policy;
+        InAbsPolicy in_abs_policy;
 
         //Statistics
         bool track_statistics;
@@ -90,6 +142,10 @@ namespace OGA
         std::unordered_map<std::pair<FINITEH::Gamestate*,int> , double, VALUE_IT::QMapHash, VALUE_IT::QMapCompare>* Q_map;
         Agent* distribution_agent;
 
+        //Telemetry
+        int telemetry_decision = 0;
+        void writeTelemetry(const OgaSearchStats& search_stats);
+
         constexpr static double TIEBREAKER_NOISE = 1e-6;
 
     public:
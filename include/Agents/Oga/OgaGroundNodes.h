@@ -2,6 +2,8 @@
 #define OGAGROUNDNODES_H
 
 #include <map>
+#include <mutex>
+#include <span>
 
 #include "OgaUtils.h"
 
@@ -9,9 +11,56 @@ namespace OGA {
     struct OgaSearchStats;
 
     //Forward declarations
+    class OgaStateNode;
     class OgaQStateNode;
     class OgaAbstractStateNode;
 
+    // Keys to look up ground nodes in the tree without copying the state or allocating a node
+    struct StateNodeKey
+    {
+        ABS::Gamestate* state;
+        unsigned depth;
+
+        [[nodiscard]] size_t hash() const;
+        bool operator==(const OgaStateNode& node) const;
+    };
+
+    struct QStateNodeKey
+    {
+        ABS::Gamestate* state;
+        unsigned depth;
+        int action;
+
+        [[nodiscard]] size_t hash() const;
+        bool operator==(const OgaQStateNode& node) const;
+    };
+
+    using StateNodeSet = ProbeSet<OgaStateNode, StateNodeKey>;
+    using QStateNodeSet = ProbeSet<OgaQStateNode, QStateNodeKey>;
+
+    /*
+     * The sampled successors of a q node as (probability, state node) pairs in insertion order. Successors are identified by their state node,
+     * whose state is the only copy. Few outcomes are found by a linear scan, a hash index is only built once there are more than INDEX_THRESHOLD.
+     */
+    class SuccessorList
+    {
+    public:
+        using Successor = std::pair<double, OgaStateNode*>;
+
+    private:
+        std::vector<Successor> successors{};
+        StateNodeSet index{};
+        constexpr static size_t INDEX_THRESHOLD = 8;
+
+    public:
+        [[nodiscard]] OgaStateNode* find(ABS::Gamestate* state, unsigned depth) const; //nullptr if there is no successor with this state
+        bool insert(double probability, OgaStateNode* successor); //false if the successor is already contained
+
+        [[nodiscard]] size_t size() const { return successors.size(); }
+        [[nodiscard]] std::vector<Successor>::const_iterator begin() const { return successors.begin(); }
+        [[nodiscard]] std::vector<Successor>::const_iterator end() const { return successors.end(); }
+    };
+
     class OgaStateNode
     {
     private:
@@ -26,17 +75,24 @@ namespace OGA {
         std::vector<int> untried_actions{};
         std::vector<OgaQStateNode*> children{};
 
+        // The children grouped by their abstract node, built on demand for the selection within an abstract node. grouped_children
+        // holds the groups one after the other, each in the order of children, and child_groups[i] is the range of the group of children[i].
+        std::vector<OgaQStateNode*> grouped_children{};
+        std::vector<std::pair<unsigned, unsigned>> child_groups{};
+        bool child_groups_valid = false;
+
         // OGA bookkeeping
         OgaAbstractStateNode* abstract_node = nullptr;
+        size_t abstract_position = 0; //Position in the ground node list of abstract_node
         Set<OgaQStateNode> parents{}; // Needed for updating state abstractions
         NextAbstractQStates* last_next_distr = nullptr;
         NextAbstractQStates* last_next_filtered_distr = nullptr;
 
-        // Temporarily store the trajectory path and rewards to be able to do backpropagation
-        OgaQStateNode* trajectory_parent = nullptr;
         unsigned recency_count = 0;
         bool has_received_abs_update = false;
 
+        std::mutex mutex;
+
     public:
 
         OgaStateNode(
@@ -52,9 +108,11 @@ namespace OGA {
         [[nodiscard]] unsigned getDepth() const;
         [[nodiscard]] bool isTerminal() const;
         [[nodiscard]] unsigned getId() const { return id; }
+        [[nodiscard]] std::mutex& getMutex() { return mutex; } //Guards the bookkeeping and children of the node when searching a shared tree
         [[nodiscard]] NextAbstractQStates* getLastNextDistr() const { return last_next_distr; }
         [[nodiscard]] NextAbstractQStates* getLastFilteredNextDistr() const { return last_next_filtered_distr; }
         [[nodiscard]] std::vector<int> getTriedActions() const { return tried_actions; }
+        void copyStatistics(const OgaStateNode& other); // Takes over the bookkeeping of the same node in a previous tree
 
         // MCTS bookkeeping functions
         void addVisit();
@@ -68,10 +126,14 @@ namespace OGA {
         void addChild(OgaQStateNode* child);
         void setLastNextDistr(NextAbstractQStates* next_distr, NextAbstractQStates* next_filtered_distr) { last_next_distr = next_distr; last_next_filtered_distr = next_filtered_distr; }
         [[nodiscard]] const std::vector<OgaQStateNode*>& getChildren() const;
+        [[nodiscard]] std::span<OgaQStateNode* const> getChildGroup(size_t child_idx); //Children with the abstract node of children[child_idx]
+        void invalidateChildGroups() { child_groups_valid = false; } //Whenever a child moves to another abstract node
 
         // OGA bookkeeping functions
         void setAbstractNode(OgaAbstractStateNode* abstract_node);
         [[nodiscard]] OgaAbstractStateNode* getAbstractNode() const;
+        void setAbstractPosition(size_t position) { abstract_position = position; }
+        [[nodiscard]] size_t getAbstractPosition() const { return abstract_position; }
         [[nodiscard]] const Set<OgaQStateNode>& getParents() const;
         [[nodiscard]] unsigned getRecencyCount() const { return recency_count; }
         void addRecencyCount() { recency_count++; }
@@ -79,9 +141,7 @@ namespace OGA {
         void setReceivedAbsUpdate(bool received) { has_received_abs_update = received; }
         [[nodiscard]] bool hasReceivedAbsUpdate() const { return has_received_abs_update; }
 
-        // Trajectory functions
-        void setTrajectoryParent(OgaQStateNode* parent);
-        [[nodiscard]] OgaQStateNode* popTrajectoryParent();
+        void addParent(OgaQStateNode* parent);
 
         // Functions for hashing and comparison needed for unordered_map and unordered_set
         bool operator==(const OgaStateNode& other) const;
@@ -103,17 +163,22 @@ namespace OGA {
         unsigned visits = 0;
         double values = 0;
         double squared_values = 0;
+        unsigned virtual_visits = 0; //Virtual losses of the in-flight trajectories of a shared tree, apart from the real statistics
+        double virtual_values = 0;
         OgaStateNode* parent = nullptr; // Cached for better performance in backpropagation and state abstraction updates
 
         // Bookkeeping for OGA
-        Map<ABS::Gamestate, std::pair<double, OgaStateNode*>> children{}; // Cached for better performance
+        SuccessorList children{}; // Cached for better performance
         double prob_sum = 0; //probability of sum of all sampled successors. Maximum is 1.
         OgaAbstractQStateNode* abstract_node = nullptr;
+        size_t abstract_position = 0; //Position in the ground node list of abstract_node
         std::vector<double> rewards{}; // For q state abstractions, a q state needs a deterministic reward (cost)
         unsigned recency_count = 0;
 
         bool use_ground_stats = false;
         bool has_received_abs_update = false;
+
+        std::mutex mutex;
     public:
 
         OgaQStateNode(
@@ -129,23 +194,38 @@ namespace OGA {
         [[nodiscard]] unsigned getDepth() const;
         [[nodiscard]] int getAction() const;
         [[nodiscard]] unsigned getId() const { return id; }
+        [[nodiscard]] std::mutex& getMutex() { return mutex; } //Guards the statistics and successors of the node when searching a shared tree
 
         // MCTS bookkeeping functions
         [[nodiscard]] unsigned getVisits() const;
         [[nodiscard]] double getValues() const;
         [[nodiscard]] double getSquaredValues() const;
         void addExperience(double values);
+        // Virtual loss keeps concurrent trajectories of a shared tree apart, it is counted as one visit with the given value.
+        // Only the selection sees it, all other bookkeeping uses the real statistics.
+        void addVirtualLoss(double value);
+        void removeVirtualLoss(double value);
+        [[nodiscard]] unsigned getVirtualVisits() const { return virtual_visits; }
+        [[nodiscard]] double getVirtualValues() const { return virtual_values; }
+        [[nodiscard]] double getSelectionVisits() const { return visits + virtual_visits; }
+        [[nodiscard]] double getSelectionValues() const { return values + virtual_values; }
         [[nodiscard]] double getAbsVisits() const;
         [[nodiscard]] double getAbsValues() const;
+        [[nodiscard]] double getAbsSelectionVisits() const;
+        [[nodiscard]] double getAbsSelectionValues() const;
         [[nodiscard]] bool hasReceivedAbsUpdate() const { return has_received_abs_update; }
         void setReceivedAbsUpdate(bool received) { has_received_abs_update = received; }
         double getProbSum() const { return prob_sum; }
+        void copyStatistics(const OgaQStateNode& other); // Takes over the bookkeeping of the same node in a previous tree
 
         // OGA bookkeeping functions
-        bool addChild(ABS::Gamestate* state, double probability, OgaStateNode* child);
-        [[nodiscard]] const Map<ABS::Gamestate, std::pair<double, OgaStateNode*>>* getChildren() const;
+        bool addChild(double probability, OgaStateNode* child);
+        [[nodiscard]] OgaStateNode* findChild(ABS::Gamestate* state) const; //nullptr if state has not been sampled as successor yet
+        [[nodiscard]] const SuccessorList& getChildren() const;
         void setAbstractNode(OgaAbstractQStateNode* abstract_node);
         [[nodiscard]] OgaAbstractQStateNode* getAbstractNode() const;
+        void setAbstractPosition(size_t position) { abstract_position = position; }
+        [[nodiscard]] size_t getAbstractPosition() const { return abstract_position; }
         void setRewards(std::vector<double>& rewards);
         [[nodiscard]] double getRewards(int player) const;
         void addRecencyCount();
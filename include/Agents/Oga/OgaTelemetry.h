@@ -0,0 +1,58 @@
+#ifndef OGATELEMETRY_H
+#define OGATELEMETRY_H
+
+#include <string>
+#include <vector>
+
+namespace OGA {
+
+    /*
+     * Optional instrumentation of one OGA decision. It is only collected when compiling with OGA_TELEMETRY (cmake -DOGA_TELEMETRY=ON),
+     * otherwise OgaSearchStats carries no telemetry and the OGA_TELEMETRY_* macros below expand to nothing.
+     */
+    struct OgaTelemetry
+    {
+        enum Phase {TREE_POLICY, ROLLOUT, BACKUP, ABSTRACTION_UPDATE, NUM_PHASES};
+
+        unsigned long long phase_cycles[NUM_PHASES]{};
+        unsigned long approx_equal_calls = 0;
+        unsigned long dist_calls = 0;
+        unsigned long q_transfers = 0;
+        unsigned long state_transfers = 0;
+        std::vector<unsigned long> staged_q_states{}; //Summed over all abstraction updates, indexed by depth
+        std::vector<unsigned long> staged_states{};
+
+        // Time stamp counter on x86, nanoseconds elsewhere
+        static unsigned long long cycles();
+        static void addStaged(std::vector<unsigned long>& staged, unsigned depth, size_t num);
+
+        // Adds the elapsed cycles of its lifetime to a phase
+        class PhaseTimer
+        {
+        private:
+            unsigned long long& counter;
+            unsigned long long start;
+
+        public:
+            PhaseTimer(OgaTelemetry& telemetry, Phase phase) : counter(telemetry.phase_cycles[phase]), start(cycles()) {}
+            ~PhaseTimer() { counter += cycles() - start; }
+        };
+
+        static std::string csvHeader();
+        [[nodiscard]] std::string toCsv(int decision, int iterations) const;
+        [[nodiscard]] std::string toJson(int decision, int iterations) const;
+    };
+
+}
+
+#ifdef OGA_TELEMETRY
+#define OGA_TELEMETRY_COUNT(stats, counter, n) ((stats).telemetry.counter += (n))
+#define OGA_TELEMETRY_STAGED(stats, staged, depth, n) OGA::OgaTelemetry::addStaged((stats).telemetry.staged, depth, n)
+#define OGA_TELEMETRY_PHASE(stats, phase) const OGA::OgaTelemetry::PhaseTimer oga_phase_timer((stats).telemetry, OGA::OgaTelemetry::phase)
+#else
+#define OGA_TELEMETRY_COUNT(stats, counter, n) ((void)0)
+#define OGA_TELEMETRY_STAGED(stats, staged, depth, n) ((void)0)
+#define OGA_TELEMETRY_PHASE(stats, phase) ((void)0)
+#endif
+
+#endif //OGATELEMETRY_H
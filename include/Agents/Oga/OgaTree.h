@@ -1,17 +1,29 @@
 #ifndef OGATREE_H
 #define OGATREE_H
 
+#include <cstdint>
 #include <map>
 #include <set>
+#include <vector>
 
 #include "OgaAbstractNodes.h"
 #include "OgaUtils.h"
 #include "../../Utils/ValueIteration.h"
+#include "../../Utils/NodePool.h"
 
 namespace OGA {
 
     struct OgaSearchStats;
 
+    template <class Node>
+    struct IdLess
+    {
+        bool operator()(const Node* lhs, const Node* rhs) const
+        {
+            return lhs->getId() < rhs->getId();
+        }
+    };
+
     class OgaTree
     {
     private:
@@ -19,45 +31,84 @@ namespace OGA {
         /* Behavior modifiers */
         OgaBehaviorFlags behavior_flags;
 
+        // Storage of all nodes and distributions of the tree. Everything is freed at once together with the tree.
+        // Abstract nodes that became empty are returned to their pool right away, so that their memory is reused for the next abstract node.
+        POOL::SlabPool<OgaStateNode> state_pool{};
+        POOL::SlabPool<OgaQStateNode> q_state_pool{};
+        POOL::SlabPool<OgaAbstractStateNode> abstract_state_pool{};
+        POOL::SlabPool<OgaAbstractQStateNode> abstract_q_state_pool{};
+        POOL::SlabPool<NextDistribution> next_distribution_pool{};
+        POOL::SlabPool<NextAbstractQStates> next_abstract_q_states_pool{};
+        NextAbstractQStates next_abstract_q_states_probe{};
+
         OgaStateNode* root;
         ABS::Model* model;
-        Set<OgaStateNode> d_states{}; //Contains all state-nodes in the tree
-        Set<OgaQStateNode> q_states{}; //Contains all q-state-nodes in the tree
-
-        //Helper, redundant data structure for efficiency. WARNING: Thse Maps may contain abstract nodes / distribution that are no longer part of the tree
-        std::vector<Map<OgaQStateNode, NextDistribution*>> next_distribution_map{}; //Saves the latest calculated NextDistribution for each q state
-        std::vector<Map<NextAbstractQStates, OgaAbstractStateNode*>> abstract_state_node_map{};
-
-
-        std::vector<OgaAbstractStateNode*> terminal_abstract_state_nodes{}; //Abstract states that represent the terminal states for each depth.
-        std::vector<OgaAbstractStateNode*> unexplored_abstract_state_nodes{}; //Abstract states that represent the unexplored states for each depth.
-
-        // Contains all abstract non-empty nodes of the tree
-        std::map<int,AbsStateSet> abstract_state_nodes{};
-        std::map<int,AbsQSet> abstract_q_state_nodes{};
-
-        //All abstract nodes that are no longer part of the tree because they are empty. Only neede for cleanup at the end of search
-        std::set<OgaAbstractQStateNode*> abstract_q_corpses;
-        std::set<OgaAbstractStateNode*> abstract_state_corpses;
-
-        //Helper sets for breadth-first updating to prevent multi updates. Cleared after each update.
-        std::vector<Set<OgaStateNode>> to_update_states{};
-        std::vector<Set<OgaQStateNode>> to_update_q_states{};
+        StateNodeSet d_states{}; //Contains all state-nodes in the tree
+        QStateNodeSet q_states{}; //Contains all q-state-nodes in the tree
+
+        // All abstraction data of one depth
+        struct Layer{
+            // Contains all abstract non-empty nodes of the depth
+            AbsStateSet abstract_state_nodes{};
+            AbsQSet abstract_q_state_nodes{};
+
+            OgaAbstractStateNode* terminal_abstract_state_node = nullptr; //Abstract state that represents the terminal states
+            OgaAbstractStateNode* unexplored_abstract_state_node = nullptr; //Abstract state that represents the unexplored states
+
+            //Helper, redundant data structure for efficiency. WARNING: Thse Maps may contain abstract nodes / distribution that are no longer part of the tree
+            Map<OgaQStateNode, NextDistribution*> next_distribution_map{}; //Saves the latest calculated NextDistribution for each q state
+            AbsQCandidateIndex abstract_q_index{}; //Abstract q nodes whose representant is contained in next_distribution_map, indexed by reward
+            Map<NextAbstractQStates, OgaAbstractStateNode*> abstract_state_node_map{}; //Hash-cons table of the asap signatures, each is interned once as key of its abstract node
+
+            //Helper sets for breadth-first updating to prevent multi updates, ordered by id for reproducibility. Cleared after each update.
+            std::set<OgaStateNode*, IdLess<OgaStateNode>> to_update_states{};
+            std::set<OgaQStateNode*, IdLess<OgaQStateNode>> to_update_q_states{};
+        };
+        std::vector<Layer> layers{}; //Indexed by depth, grown when the first node of a depth is created
+        void growLayers(unsigned depth);
+
+        //Bitmap of the depths with staged nodes, so that performUpdateAbstractions only visits these
+        std::vector<uint64_t> dirty_depths{};
+        size_t num_staged = 0; //Staged nodes over all depths
+        void markDirty(unsigned depth);
+        [[nodiscard]] int deepestDirtyDepth(int max_depth) const; //Deepest dirty depth <= max_depth, -1 if there is none
+
+        //Cached log(n) for the visit counts of the UCB formula, only small counts are tabulated
+        constexpr static size_t LOG_TABLE_SIZE = 1 << 16;
+        std::vector<double> log_table{};
+
+        void initStateAbstraction(OgaStateNode* state_node, OgaSearchStats& search_stats);
+        void initQStateAbstraction(OgaQStateNode* q_state_node, OgaSearchStats& search_stats);
 
         void _stageForUpdate(OgaStateNode* state_node);
         void _stageForUpdate(OgaQStateNode* q_state_node);
 
         void updateQAbstractions(unsigned K, int depth, std::mt19937& rng, OgaSearchStats& search_stats);
+
+        // Candidate search for non-exact q abstractions (eps_a, eps_t), backed by abstract_q_index
+        constexpr static double CANDIDATE_SLACK = 1e-9; //Guards the pruning bounds against rounding errors
+        constexpr static double MIN_DIST_BAND = 1e-3; //Candidates whose distance lower bound exceeds the minimal distance by more than this are never evaluated
+        // next_distribution->approxEqual with the eps of behavior_flags, counted in the telemetry
+        bool approxEqual(const NextDistribution* next_distribution, const NextDistribution* other_distribution, OgaSearchStats& search_stats) const;
+        void updateCandidateIndex(OgaAbstractQStateNode* abstract_node, int depth);
+        OgaAbstractQStateNode* findMergeCandidate(const NextDistribution* next_distribution, int depth, OgaSearchStats& search_stats);
+        OgaAbstractQStateNode* findMinDistCandidate(const NextDistribution* next_distribution, int depth, double& min_dist, OgaSearchStats& search_stats);
         void updateStateAbstractions(unsigned K, int depth, OgaSearchStats& search_stats, std::mt19937& rng);
 
     public:
         explicit OgaTree(ABS::Gamestate* root_state, ABS::Model* model, const OgaBehaviorFlags& behavior_flags, std::mt19937& rng, OgaSearchStats& search_stats
         );
+        // Tree reuse: Copies the subtree below new_root of a previous tree, with all depths decreased by the depth of new_root
+        explicit OgaTree(const OgaTree& previous_tree, const OgaStateNode* new_root, ABS::Model* model, OgaSearchStats& search_stats);
 
         ~OgaTree();
 
         [[nodiscard]] OgaStateNode* getRoot() const;
+        [[nodiscard]] double logVisits(double visits);
+        void tabulateLogVisits(); //Tabulates all small counts at once, so that logVisits can be called concurrently afterwards
 
+        [[nodiscard]] OgaStateNode* findState(ABS::Gamestate* state, unsigned depth) const; //nullptr if the state is not in the tree
+        [[nodiscard]] size_t numNodes() const { return d_states.size() + q_states.size(); }
         [[nodiscard]] std::pair<OgaStateNode*, bool> findOrCreateState(ABS::Gamestate* state, unsigned depth, std::mt19937& rng, OgaSearchStats& search_stats
         );
 
@@ -69,6 +120,7 @@ namespace OGA {
 
 
         void performUpdateAbstractions(unsigned K, OgaSearchStats& search_stats, std::mt19937& rng);
+        [[nodiscard]] size_t numStagedNodes() const { return num_staged; }
         void addUpdateQStateNodeAbstraction(OgaQStateNode* q_state_node);
         void addUpdateStateNodeAbstraction(OgaStateNode* state_node);
 
@@ -77,7 +129,7 @@ namespace OGA {
         bool distrSimilarity(NextAbstractQStates* nd1, NextAbstractQStates* nf1, NextAbstractQStates* nd2, NextAbstractQStates* nf2, OgaStateNode* s1, OgaStateNode* s2);
 
         // Debugging/Statistics functions
-        void printAbsTree(ABS::Model* model, size_t layers) const;
+        void printAbsTree(ABS::Model* model, size_t num_layers) const;
         void updateStatistics(std::map<std::string,std::map<int,double>>& layerwise_statistics, std::map<std::string,double>& global_statistics, std::unordered_map<std::pair<FINITEH::Gamestate*,int> , double, VALUE_IT::QMapHash, VALUE_IT::QMapCompare>* Q_map, std::mt19937& rng);
         void estimateValueEquivalentAbsStateRatio(std::unordered_map<std::pair<FINITEH::Gamestate*,int> , double, VALUE_IT::QMapHash, VALUE_IT::QMapCompare>* Q_map, int sample_pairs, std::mt19937& rng, std::map<std::string,double>& global_statistics, std::map<std::string,std::map<int,double>>& layerwise_statistics);
     };
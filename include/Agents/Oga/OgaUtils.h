@@ -1,8 +1,10 @@
 #ifndef OGAUTILS_H
 #define OGAUTILS_H
 
+#include <set>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "../../Games/Gamestate.h"
 
@@ -13,6 +15,9 @@ namespace OGA {
     class OgaAbstractStateNode;
     class NextDistribution;
 
+    enum class QAbsAlg {EPS, RANDOM};
+    enum class StateAbsAlg {ASAP, RANDOM};
+
     struct OgaBehaviorFlags{
 
         bool group_terminal_states : 1 = true;
@@ -29,6 +34,11 @@ namespace OGA {
         //For value-based state abstractions
         std::string state_abs_alg = "asap"; //vals: 'asap'
         double equiv_chance = 0.01; //for random abstraction updates
+
+        //q_abs_alg and state_abs_alg resolved by resolveAlgorithms(), so that the search does not need to compare strings
+        QAbsAlg resolved_q_abs_alg = QAbsAlg::EPS;
+        StateAbsAlg resolved_state_abs_alg = StateAbsAlg::ASAP;
+        void resolveAlgorithms();
     };
 
     class OgaStateNode;
@@ -57,46 +67,130 @@ namespace OGA {
     template <class T>
     using Set = std::unordered_set<T*, PointedHash<T>, PointedCompare<T>>;
 
+    /*
+     * Transparent variants that additionally accept a lightweight Key (providing hash() and operator==(const T&)),
+     * so that a set can be probed without constructing a T first.
+     */
+    template <class T, class Key>
+    struct ProbeHash : PointedHash<T>
+    {
+        using is_transparent = void;
+        using PointedHash<T>::operator();
+
+        size_t operator()(const Key& key) const
+        {
+            return key.hash();
+        }
+    };
+
+    template <class T, class Key>
+    struct ProbeCompare : PointedCompare<T>
+    {
+        using is_transparent = void;
+        using PointedCompare<T>::operator();
+
+        bool operator()(const Key& key, const T* node) const
+        {
+            return key == *node;
+        }
+
+        bool operator()(const T* node, const Key& key) const
+        {
+            return key == *node;
+        }
+    };
+
+    template <class T, class Key>
+    using ProbeSet = std::unordered_set<T*, ProbeHash<T, Key>, ProbeCompare<T, Key>>;
+
     template <class T, class U>
     using Map = std::unordered_map<T*, U, PointedHash<T>, PointedCompare<T>>;
 
     /*
      * Saves the probability of changing from one q state (depth d) to an abstract state with depth d + 1
      * with reward r.
+     * The distribution is stored as (abstract node id, probability) pairs sorted by id, so that distances can be computed
+     * by a single merge in a reproducible order.
      */
     class NextDistribution
     {
+    public:
+        using Outcome = std::pair<unsigned, double>; //abstract state node id, probability
+
     private:
-        Map<OgaAbstractStateNode, double> distribution{};
+        std::vector<Outcome> distribution{};
         double rewards;
         bool consider_missing_outcomes;
 
+        // Cheap signature of the distribution used to prune candidates before computing transDist
+        double mass = 0;
+        double max_probability = 0;
+
     public:
 
         explicit NextDistribution(const double rewards, bool consider_missing_outcomes);
         void addProbability(OgaAbstractStateNode* next_abstract_state_node, double probability);
 
         double getRewards() const;
-        const Map<OgaAbstractStateNode, double>& getDistribution() const;
+        const std::vector<Outcome>& getDistribution() const;
 
         [[nodiscard]] double rewardDist(const NextDistribution* other) const;
-        [[nodiscard]] double transDist(const NextDistribution* other) const;
+        // L1 distance of both distributions. Stops early and returns a value larger than bound once the distance exceeds it.
+        [[nodiscard]] double transDist(const NextDistribution* other, double bound = std::numeric_limits<double>::infinity()) const;
+        [[nodiscard]] double transDistLowerBound(const NextDistribution* other) const;
 
         [[nodiscard]] double dist(const NextDistribution* other) const;
         bool approxEqual(const NextDistribution* other, double exp_a, double exp_t) const;
     };
 
+    /*
+     * Index over the abstract q nodes of one depth whose representant has a NextDistribution, ordered by the reward of that distribution.
+     * Used to only consider abstract nodes with a matching reward when searching for an abstraction in updateQAbstractions.
+     */
+    class AbsQCandidateIndex
+    {
+    public:
+        using Entry = std::pair<double, OgaAbstractQStateNode*>;
+
+    private:
+        struct EntryCompare {
+            bool operator()(const Entry& lhs, const Entry& rhs) const;
+        };
+
+        std::set<Entry, EntryCompare> entries{};
+        std::unordered_map<OgaAbstractQStateNode*, double> keys{};
+
+    public:
+        using Iterator = std::set<Entry, EntryCompare>::const_iterator;
+
+        void update(OgaAbstractQStateNode* abstract_node, const NextDistribution* representant_distribution);
+        void remove(OgaAbstractQStateNode* abstract_node);
+
+        [[nodiscard]] Iterator lowerBound(double rewards) const;
+        [[nodiscard]] Iterator begin() const { return entries.begin(); }
+        [[nodiscard]] Iterator end() const { return entries.end(); }
+        [[nodiscard]] size_t size() const { return entries.size(); }
+    };
+
+    /*
+     * The set of abstract q nodes of the children of a state node, used as key for asap state abstractions.
+     * The abstract nodes are stored by id (sorted), so that a key stays valid when one of its abstract nodes dies and its memory is recycled.
+     * The hash is a sum of mixed ids, so it is maintained incrementally and, unlike xor, does not cancel out for similar id sets.
+     */
     class NextAbstractQStates
     {
     private:
-        Set<OgaAbstractQStateNode> states{};
+        std::vector<unsigned> ids{};
+        size_t ids_hash = 0;
 
     public:
         NextAbstractQStates() = default;
 
-        void addAbstractQState(OgaAbstractQStateNode* next_abstract_q_state_node);
+        void addAbstractQState(const OgaAbstractQStateNode* next_abstract_q_state_node);
+        void clear(); //Keeps the capacity, for keys that are reused as lookup probe
 
-        const Set<OgaAbstractQStateNode>& getStates() const;
+        [[nodiscard]] const std::vector<unsigned>& getIds() const;
+        [[nodiscard]] bool contains(unsigned id) const;
 
         bool operator==(const NextAbstractQStates& other) const;
         [[nodiscard]] size_t hash() const;
@@ -49,6 +49,10 @@ namespace ABS
         protected:
             virtual std::pair<std::vector<double>,double> applyAction_(Gamestate* uncasted_state, int action, std::mt19937& rng, std::vector<std::pair<int,int>>* decision_outcomes)=0; //required
             virtual std::vector<int> getActions_(Gamestate* uncasted_state)=0; //required
+            virtual void getActionsInto_(Gamestate* uncasted_state, std::vector<int>& actions) { //Optional, fills actions without allocating
+                const auto state_actions = getActions_(uncasted_state);
+                actions.assign(state_actions.begin(), state_actions.end());
+            }
             long total_forward_calls = 0;
 
             std::map<int,std::vector<int>> action_encoding_map;
@@ -63,11 +67,25 @@ namespace ABS
             virtual bool hasTransitionProbs()=0; //Required
 
             virtual Gamestate* copyState(Gamestate* uncasted_state)=0; //Required
+            virtual Model* clone() { //optional, needed for searching with several threads. The clone must not share mutable state with the original
+                throw std::runtime_error("Cloning not implemented.");
+            }
+
+            //Optional, lets search trees keep their states in their own memory. copyStateInto constructs the copy in memory, which has
+            //getStateSize() bytes aligned to alignof(std::max_align_t). The copy is destroyed by calling its destructor instead of delete.
+            virtual size_t getStateSize() { return 0; } //0 if copyStateInto is not implemented
+            virtual Gamestate* copyStateInto(Gamestate* uncasted_state, void* memory) {
+                throw std::runtime_error("Copying into memory not implemented.");
+            }
 
             virtual std::vector<int> getActions(Gamestate* uncasted_state) final {
                 assert (!uncasted_state->terminal); //state must not be terminal
                 return getActions_(uncasted_state);
             };
+            virtual void getActions(Gamestate* uncasted_state, std::vector<int>& actions) final { //Same actions, reusing the memory of actions
+                assert (!uncasted_state->terminal); //state must not be terminal
+                getActionsInto_(uncasted_state, actions);
+            };
 
             //Assertions:
             //1. Reward depends only on the state and action and NOT the sampled successor, i.e. R(s,a)
@@ -143,6 +161,10 @@ namespace ABS
                 return total_forward_calls;
             };
 
+            void addForwardCalls(long forward_calls) { //For forward calls that were made on clones of this model
+                total_forward_calls += forward_calls;
+            }
+
             //For potential ML applications
             [[nodiscard]] virtual std::vector<int> obsShape() const { //optional [wär aber nett]
                 throw std::runtime_error("Observation Shape not implemented."); //Assuming obs can always be represented as a multi-dim box
@@ -55,6 +55,7 @@ namespace AA
         ABS::Gamestate* getInitialState(std::mt19937& rng) override;
         ABS::Gamestate* getInitialState(int num) override;
         ABS::Gamestate* copyState(ABS::Gamestate* uncasted_state) override;
+        ABS::Model* clone() override { return new Model(*this); }
         int getNumPlayers() override;
         bool hasTransitionProbs() override {return true;}
 
@@ -60,6 +60,7 @@ namespace RECON
         bool hasTransitionProbs() override {return true;}
         Gamestate* getInitialState(std::mt19937& rng) override;
         Gamestate* copyState(Gamestate* state) override;
+        Model* clone() override { return new ReconModel(*this); }
         void printState(Gamestate* state) override;
 
         [[nodiscard]] std::vector<int> obsShape() const override;
@@ -45,6 +45,7 @@ namespace EO {
         bool hasTransitionProbs() override {return true;}
         int getNumPlayers() override;
         ABS::Gamestate* copyState(ABS::Gamestate* uncasted_state) override;
+        ABS::Model* clone() override { return new Model(*this); }
 
         [[nodiscard]] std::vector<int> obsShape() const override;
         void getObs(ABS::Gamestate* uncasted_state, int* obs) override;
@@ -50,6 +50,7 @@ namespace ELE {
         bool hasTransitionProbs() override {return true;}
         int getNumPlayers() override;
         ABS::Gamestate* copyState(ABS::Gamestate* uncasted_state) override;
+        ABS::Model* clone() override { return new Model(*this); }
 
         [[nodiscard]] double getMinV(int steps) const override {
             return -(num_elevators * 2 * std::max(ELEVATOR_PENALTY_WRONG_DIR,ELEVATOR_PENALTY_RIGHT_DIR) +
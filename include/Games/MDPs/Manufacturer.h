@@ -58,6 +58,7 @@ namespace MAN {
         int getNumPlayers() override;
         bool hasTransitionProbs() override {return true;}
         ABS::Gamestate* copyState(ABS::Gamestate* uncasted_state) override;
+        ABS::Model* clone() override { return new Model(*this); }
     };
 
 } // namespace ABS
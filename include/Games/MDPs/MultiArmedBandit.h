@@ -30,6 +30,7 @@ namespace MAB
             void printState(ABS::Gamestate* state) override;
             ABS::Gamestate* getInitialState(std::mt19937& rng) override;
             ABS::Gamestate* copyState(ABS::Gamestate* uncasted_state) override;
+            ABS::Model* clone() override { return new Model(*this); }
             int getNumPlayers() override;
             bool hasTransitionProbs() override {return true;}
 
@@ -27,6 +27,9 @@ namespace RT
         void printState(ABS::Gamestate* state) override;
         ABS::Gamestate* getInitialState(std::mt19937& rng) override;
         ABS::Gamestate* copyState(ABS::Gamestate* uncasted_state) override;
+        ABS::Model* clone() override { return new Model(*this); }
+        size_t getStateSize() override { return sizeof(Gamestate); }
+        ABS::Gamestate* copyStateInto(ABS::Gamestate* uncasted_state, void* memory) override;
         int getNumPlayers() override;
         std::vector<double> heuristicsValue(ABS::Gamestate* state) override;
         bool hasTransitionProbs() override {return true;}
@@ -62,6 +65,7 @@ namespace RT
         std::pair<int,int> path_interrupt_pos(int x1, int y1, int x2, int y2);
         std::pair<std::vector<double>,double> applyAction_(ABS::Gamestate* uncasted_state, int action, std::mt19937& rng, std::vector<std::pair<int,int>>* decision_outcomes) override;
         std::vector<int> getActions_(ABS::Gamestate* uncasted_state) override;
+        void getActionsInto_(ABS::Gamestate* uncasted_state, std::vector<int>& actions) override;
     };
 
 }
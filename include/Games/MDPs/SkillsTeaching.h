@@ -51,6 +51,7 @@ namespace ST {
         ABS::Gamestate* getInitialState(std::mt19937& rng) override;
         int getNumPlayers() override;
         ABS::Gamestate* copyState(ABS::Gamestate* uncasted_state) override;
+        ABS::Model* clone() override { return new SkillsTeachingModel(*this); }
         bool hasTransitionProbs() override {return true;}
 
         [[nodiscard]] std::vector<int> obsShape() const override;
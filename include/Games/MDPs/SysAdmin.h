@@ -36,6 +36,9 @@ namespace SA
         ABS::Gamestate* getInitialState(std::mt19937& rng) override;
         ABS::Gamestate* getInitialState(int num) override;
         ABS::Gamestate* copyState(ABS::Gamestate* uncasted_state) override;
+        ABS::Model* clone() override { return new Model(*this); }
+        size_t getStateSize() override { return sizeof(Gamestate); }
+        ABS::Gamestate* copyStateInto(ABS::Gamestate* uncasted_state, void* memory) override;
         int getNumPlayers() override;
         bool hasTransitionProbs() override {return true;}
 
@@ -54,6 +57,7 @@ namespace SA
         std::vector<int> actions;
         std::pair<std::vector<double>,double> applyAction_(ABS::Gamestate* uncasted_state, int action, std::mt19937& rng, std::vector<std::pair<int,int>>* decision_outcomes) override;
         std::vector<int> getActions_(ABS::Gamestate* uncasted_state) override;
+        void getActionsInto_(ABS::Gamestate* uncasted_state, std::vector<int>& available_actions) override;
     };
 
 }
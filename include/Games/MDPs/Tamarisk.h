@@ -76,6 +76,7 @@ public:
     ABS::Gamestate* getInitialState(std::mt19937& rng) override;
     int getNumPlayers() override;
     ABS::Gamestate* copyState(ABS::Gamestate* uncasted_state) override;
+    ABS::Model* clone() override { return new Model(*this); }
     bool hasTransitionProbs() override {return true;}
 
     [[nodiscard]] double getMinV(int steps) const override {
@@ -72,6 +72,7 @@ public:
     void printState(ABS::Gamestate* uncasted_state) override;
     ABS::Gamestate* getInitialState(std::mt19937& rng) override;
     ABS::Gamestate* copyState(ABS::Gamestate* uncasted_state) override;
+    ABS::Model* clone() override { return new TrafficModel(*this); }
     int getNumPlayers() override { return 1; }
     bool hasTransitionProbs() override {return true;}
 
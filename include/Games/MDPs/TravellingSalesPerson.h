@@ -3,6 +3,7 @@
 #ifndef TRAVELLING_SALES_PERSON_H
 #define TRAVELLING_SALES_PERSON_H
 #include <vector>
+#include <algorithm>
 
 #include "../Gamestate.h"
 #endif
@@ -32,6 +33,7 @@ namespace TRAVELLING_SALES_PERSON
         ABS::Gamestate* getInitialState(std::mt19937& rng) override;
         ABS::Gamestate* getInitialState(int num) override;
         ABS::Gamestate* copyState(ABS::Gamestate* uncasted_state) override;
+        ABS::Model* clone() override { return new Model(*this); }
         int getNumPlayers() override;
         bool hasTransitionProbs() override {return true;}
 
@@ -47,6 +47,7 @@ namespace TRT {
         ABS::Gamestate* getInitialState(std::mt19937& rng) override;
         int getNumPlayers() override;
         ABS::Gamestate* copyState(ABS::Gamestate* uncasted_state) override;
+        ABS::Model* clone() override { return new Model(*this); }
         bool hasTransitionProbs() override {return true;}
 
         [[nodiscard]] std::vector<int> obsShape() const override;
@@ -42,6 +42,7 @@ namespace WLP {
         ABS::Gamestate* getInitialState(std::mt19937& rng) override;
         int getNumPlayers() override;
         ABS::Gamestate* copyState(ABS::Gamestate* uncasted_state) override;
+        ABS::Model* clone() override { return new Model(*this); }
         bool hasTransitionProbs() override {return false;}
 
         [[nodiscard]] std::vector<int> obsShape() const override;
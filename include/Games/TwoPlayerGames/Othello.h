@@ -31,6 +31,9 @@ namespace OTH {
             void printState(ABS::Gamestate* state) override;
             ABS::Gamestate* getInitialState(std::mt19937& rng) override;
             ABS::Gamestate* copyState(ABS::Gamestate* uncasted_state) override;
+            ABS::Model* clone() override { return new Model(*this); }
+            size_t getStateSize() override { return sizeof(Gamestate); }
+            ABS::Gamestate* copyStateInto(ABS::Gamestate* uncasted_state, void* memory) override;
             int getNumPlayers() override;
             bool hasTransitionProbs() override {return true;}
 
@@ -55,6 +55,7 @@ namespace PUS
             void printState(ABS::Gamestate* state) override;
             ABS::Gamestate* getInitialState(std::mt19937& rng) override;
             ABS::Gamestate* copyState(ABS::Gamestate* uncasted_state) override;
+            ABS::Model* clone() override { return new Model(*this); }
             int getNumPlayers() override;
             bool hasTransitionProbs() override {return true;}
             std::vector<double> heuristicsValue(ABS::Gamestate* state) override;
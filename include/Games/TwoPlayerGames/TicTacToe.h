@@ -42,6 +42,7 @@ namespace TTT
             void printState(ABS::Gamestate* state) override;
             ABS::Gamestate* getInitialState(std::mt19937& rng) override;
             ABS::Gamestate* copyState(ABS::Gamestate* uncasted_state) override;
+            ABS::Model* clone() override { return new Model(*this); }
             int getNumPlayers() override;
             bool hasTransitionProbs() override {return true;}
 
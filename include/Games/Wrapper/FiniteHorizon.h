@@ -22,8 +22,11 @@ namespace FINITEH
 
 
         bool free_ground_state = true;
+        bool ground_state_in_place = false; //Ground state was constructed by copyStateInto and is always owned
         ~Gamestate() override {
-            if (free_ground_state)
+            if (ground_state_in_place)
+                ground_state->~Gamestate();
+            else if (free_ground_state)
                 delete ground_state;
         }
     };
@@ -39,6 +42,9 @@ namespace FINITEH
         ABS::Gamestate* getInitialState(std::mt19937& rng) override;
         ABS::Gamestate* getInitialState(int num) override;
         ABS::Gamestate* copyState(ABS::Gamestate* uncasted_state) override;
+        ABS::Model* clone() override;
+        size_t getStateSize() override;
+        ABS::Gamestate* copyStateInto(ABS::Gamestate* uncasted_state, void* memory) override;
         int getNumPlayers() override;
         bool hasTransitionProbs() override;
         ABS::Model* getGroundModel() {return original_model;}
@@ -93,6 +99,7 @@ namespace FINITEH
 
         std::pair<std::vector<double>,double> applyAction_(ABS::Gamestate* uncasted_state, int action, std::mt19937& rng, std::vector<std::pair<int,int>>* decision_outcomes) override;
         std::vector<int> getActions_(ABS::Gamestate* uncasted_state) override;
+        void getActionsInto_(ABS::Gamestate* uncasted_state, std::vector<int>& actions) override;
     };
 
 }
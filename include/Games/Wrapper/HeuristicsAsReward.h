@@ -18,6 +18,7 @@ namespace HEURISTICSASREWARD
         ABS::Gamestate* getInitialState(std::mt19937& rng) override;
         ABS::Gamestate* getInitialState(int num) override;
         ABS::Gamestate* copyState(ABS::Gamestate* uncasted_state) override;
+        ABS::Model* clone() override;
         int getNumPlayers() override;
         bool hasTransitionProbs() override;
         ABS::Model* getGroundModel() {return original_model;}
@@ -11,4 +11,11 @@ namespace MEMORY{
 
     void PrintUsedMemory();
 
-}
\ No newline at end of file
+    // Resident memory of this process in MB, -1 if it can not be determined
+    double GetUsedMemory();
+    double GetPeakMemory();
+
+    // Restarts the peak measurement at the current resident memory (Linux only, elsewhere the peak stays the process-wide one)
+    void ResetPeakMemory();
+
+}
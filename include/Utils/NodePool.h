@@ -0,0 +1,227 @@
+#pragma once
+
+#ifndef NODEPOOL_H
+#define NODEPOOL_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#endif
+
+namespace POOL
+{
+
+    /*
+     * Slab allocator for objects of a single type that all share the lifetime of one search tree.
+     * Objects are bump-allocated from fixed-size slabs, so consecutively created objects are close in memory.
+     * Single objects can be returned with destroy() (their slot is reused by the next create()), everything else
+     * is torn down at once with reset() or when the pool is destroyed.
+     */
+    template <class T, size_t SLAB_SIZE = 1024>
+    class SlabPool
+    {
+    private:
+        struct Slot{
+            alignas(T) unsigned char storage[sizeof(T)];
+            bool live = false;
+        };
+
+        std::vector<Slot*> slabs{};
+        std::vector<Slot*> free_slots{};
+        size_t used = 0; //Number of bump-allocated slots over all slabs
+
+        static Slot* slotOf(T* obj) {
+            static_assert(offsetof(Slot, storage) == 0);
+            return reinterpret_cast<Slot*>(obj);
+        }
+
+        Slot* nextSlot() {
+            if (!free_slots.empty()) {
+                Slot* slot = free_slots.back();
+                free_slots.pop_back();
+                return slot;
+            }
+            if (used == slabs.size() * SLAB_SIZE)
+                slabs.push_back(new Slot[SLAB_SIZE]);
+            Slot* slot = &slabs[used / SLAB_SIZE][used % SLAB_SIZE];
+            used++;
+            return slot;
+        }
+
+    public:
+        SlabPool() = default;
+        SlabPool(const SlabPool&) = delete;
+        SlabPool& operator=(const SlabPool&) = delete;
+
+        ~SlabPool() {
+            reset();
+            for (Slot* slab : slabs)
+                delete[] slab;
+        }
+
+        template <class... Args>
+        T* create(Args&&... args) {
+            Slot* slot = nextSlot();
+            T* obj = new (slot->storage) T(std::forward<Args>(args)...);
+            slot->live = true;
+            return obj;
+        }
+
+        void destroy(T* obj) {
+            if (obj == nullptr)
+                return;
+            Slot* slot = slotOf(obj);
+            assert (slot->live);
+            obj->~T();
+            slot->live = false;
+            free_slots.push_back(slot);
+        }
+
+        // Destroys all live objects and rewinds the pool. The slabs are kept for reuse.
+        void reset() {
+            for (size_t i = 0; i < used; i++) {
+                Slot& slot = slabs[i / SLAB_SIZE][i % SLAB_SIZE];
+                if constexpr (!std::is_trivially_destructible_v<T>) {
+                    if (slot.live)
+                        std::launder(reinterpret_cast<T*>(slot.storage))->~T();
+                }
+                slot.live = false;
+            }
+            free_slots.clear();
+            used = 0;
+        }
+
+        [[nodiscard]] size_t size() const { return used - free_slots.size(); }
+    };
+
+
+    /*
+     * Bump allocator for everything that shares the lifetime of one search tree, e.g. nodes whose containers allocate from the
+     * arena itself (it is a std::pmr::memory_resource). reset() frees everything at once: Objects created with create() or construct()
+     * get their destructor called and adopted heap objects are deleted, all other memory is only rewound. Objects from createUntracked()
+     * are never destroyed and therefore must not own memory outside the arena. The chunks are kept for the next tree.
+     * A concurrent arena can be used by several threads at once, except for destroyLast().
+     */
+    class TreeArena final : public std::pmr::memory_resource
+    {
+    private:
+        struct Cleanup{
+            void* obj;
+            void (*cleanup)(void*);
+            // Arena memory of the object, chunk is NO_CHUNK for adopted heap objects
+            size_t chunk;
+            size_t begin;
+            size_t end;
+        };
+
+        constexpr static size_t NO_CHUNK = static_cast<size_t>(-1);
+
+        constexpr static size_t CHUNK_SIZE = 1 << 16;
+
+        std::vector<std::pair<char*, size_t>> chunks{}; //Begin and size
+        size_t current = 0; //Chunk that is allocated from
+        size_t offset = 0; //Used bytes of the current chunk
+        std::vector<Cleanup> cleanups{};
+        std::unique_ptr<std::mutex> mutex; //Only for concurrent arenas
+
+        std::unique_lock<std::mutex> lock() {
+            return mutex == nullptr? std::unique_lock<std::mutex>() : std::unique_lock(*mutex);
+        }
+
+        void* bump(const size_t bytes, const size_t alignment) {
+            while (true) {
+                if (current == chunks.size()) {
+                    const size_t size = std::max(CHUNK_SIZE, bytes + alignment);
+                    chunks.emplace_back(static_cast<char*>(::operator new(size)), size);
+                }
+                auto [begin, size] = chunks[current];
+                const uintptr_t address = reinterpret_cast<uintptr_t>(begin) + offset;
+                const size_t aligned_offset = offset + ((alignment - address % alignment) % alignment);
+                if (aligned_offset + bytes <= size) {
+                    offset = aligned_offset + bytes;
+                    return begin + aligned_offset;
+                }
+                current++;
+                offset = 0;
+            }
+        }
+
+        void* do_allocate(const size_t bytes, const size_t alignment) override {
+            const auto guard = lock();
+            return bump(bytes, alignment);
+        }
+        void do_deallocate(void*, size_t, size_t) override {} //Memory is only released by reset()
+        [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    public:
+        explicit TreeArena(const bool concurrent = false) : mutex(concurrent? std::make_unique<std::mutex>() : nullptr) {}
+        TreeArena(const TreeArena&) = delete;
+        TreeArena& operator=(const TreeArena&) = delete;
+
+        ~TreeArena() override {
+            reset();
+            for (auto [begin, size] : chunks)
+                ::operator delete(begin);
+        }
+
+        template <class T, class... Args>
+        T* create(Args&&... args) {
+            return construct<T>(sizeof(T), alignof(T), [&](void* memory) { return new (memory) T(std::forward<Args>(args)...); });
+        }
+
+        template <class T, class... Args>
+        T* createUntracked(Args&&... args) {
+            void* memory = allocate(sizeof(T), alignof(T));
+            return new (memory) T(std::forward<Args>(args)...);
+        }
+
+        // Lets construct_at(memory) construct an object of static type T (but possibly of a derived type, hence the size) in the arena
+        template <class T, class F>
+        T* construct(const size_t size, const size_t alignment, F&& construct_at) {
+            const auto guard = lock();
+            void* memory = bump(size, alignment);
+            T* obj = construct_at(memory);
+            if constexpr (!std::is_trivially_destructible_v<T>)
+                cleanups.push_back({obj, [](void* p) { static_cast<T*>(p)->~T(); }, current, offset - size, offset});
+            return obj;
+        }
+
+        // Takes ownership of a heap object, which is deleted on reset()
+        template <class T>
+        T* adopt(T* obj) {
+            const auto guard = lock();
+            cleanups.push_back({obj, [](void* p) { delete static_cast<T*>(p); }, NO_CHUNK, 0, 0});
+            return obj;
+        }
+
+        // Destroys obj, which has to be the last object that was created or adopted, and also frees its memory if nothing was allocated after it
+        template <class T>
+        void destroyLast(T* obj) {
+            assert (mutex == nullptr && !cleanups.empty() && cleanups.back().obj == obj);
+            const Cleanup cleanup = cleanups.back();
+            cleanups.pop_back();
+            cleanup.cleanup(cleanup.obj);
+            if (cleanup.chunk == current && cleanup.end == offset)
+                offset = cleanup.begin;
+        }
+
+        // Destroys all tracked objects and rewinds the arena
+        void reset() {
+            for (auto it = cleanups.rbegin(); it != cleanups.rend(); ++it)
+                it->cleanup(it->obj);
+            cleanups.clear();
+            current = 0;
+            offset = 0;
+        }
+    };
+
+}
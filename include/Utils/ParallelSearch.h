@@ -0,0 +1,114 @@
+#pragma once
+
+#ifndef PARALLELSEARCH_H
+#define PARALLELSEARCH_H
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../Games/Gamestate.h"
+#include "ThreadPool.h"
+
+#endif
+
+namespace PARALLEL
+{
+
+    /*
+     * Models for the workers of a parallel search, all but the original are clones of it. Clones start with the forward calls of
+     * the original, so only the calls they made since cloning are added to the original, by creditForwardCalls() and on destruction.
+     */
+    class ModelClones
+    {
+    private:
+        ABS::Model* original;
+        std::vector<ABS::Model*> models{};
+        std::vector<long> credited_forward_calls{}; //Forward calls of each clone that the original already knows of
+        bool first_is_original;
+
+    public:
+        // num models, of which the first is the original itself if first_is_original
+        ModelClones(ABS::Model* original, int num, bool first_is_original = false);
+        ModelClones(const ModelClones&) = delete;
+        ModelClones& operator=(const ModelClones&) = delete;
+        ~ModelClones(); //Credits the remaining forward calls and deletes the clones
+
+        void creditForwardCalls();
+
+        ABS::Model* operator[](const int i) const { return models[i]; }
+        [[nodiscard]] int size() const { return static_cast<int>(models.size()); }
+    };
+
+    /*
+     * Memory that one thread reuses for all its rollouts: the rollout state is constructed in a buffer of getStateSize() bytes,
+     * or copied to the heap if the model does not support copyStateInto, and the available actions are filled into one vector.
+     */
+    class RolloutScratch
+    {
+    private:
+        std::vector<std::max_align_t> buffer{};
+        bool state_in_buffer = false;
+
+    public:
+        std::vector<int> actions{};
+
+        // Copy of state for one rollout, which has to be released before the next one
+        ABS::Gamestate* copyState(ABS::Model* model, const ABS::Gamestate* state);
+        void release(ABS::Gamestate* rollout_state);
+    };
+
+    // num random streams seeded from rng
+    std::vector<std::mt19937> forkRngs(std::mt19937& rng, int num);
+
+    // Runs work(worker) for every worker in [0, num) on its own thread and returns once all are done
+    void runWorkers(int num, const std::function<void(int worker)>& work);
+
+    // Budgets of the workers of a root-parallel search: An iteration budget is split among at most budget.amount workers,
+    // any other budget is given to all threads, which then share it
+    template <class Budget>
+    std::vector<Budget> splitBudget(const Budget& budget, const int threads)
+    {
+        const int num_workers = budget.quantity == "iterations"? std::max(1, std::min(threads, budget.amount)) : threads;
+        std::vector<Budget> budgets(num_workers, budget);
+        if (budget.quantity == "iterations") {
+            for (int i = 0; i < num_workers; i++)
+                budgets[i].amount = budget.amount / num_workers + (i < budget.amount % num_workers ? 1 : 0);
+        }
+        return budgets;
+    }
+
+    /*
+     * Plays the rollouts of one leaf in parallel. Every rollout gets its own seed, so the result does not depend on which thread
+     * plays it, and every thread works on its own clone of the searched model, which has to be attached before.
+     */
+    class RolloutPool
+    {
+    private:
+        ThreadPool pool;
+        std::unique_ptr<ModelClones> models;
+        std::vector<RolloutScratch> scratches;
+        std::vector<unsigned> seeds{};
+        std::vector<double> rewards{};
+
+    public:
+        // Plays one rollout with the given model, random stream and scratch memory of its thread and adds its rewards to reward_sum
+        using PlayRollout = std::function<void(ABS::Model* model, std::mt19937& rng, double* reward_sum, RolloutScratch& scratch)>;
+
+        explicit RolloutPool(int num_threads) : pool(num_threads), scratches(num_threads) {}
+
+        void attach(ABS::Model* model) { models = std::make_unique<ModelClones>(model, pool.size()); }
+        void detach() { models.reset(); }
+
+        // Plays num_rollouts rollouts and adds their rewards, num_players per rollout, to reward_sum in the order of the rollouts.
+        // The forward calls of the clones are credited to the attached model.
+        void playRollouts(int num_rollouts, int num_players, std::mt19937& rng, const PlayRollout& play, double* reward_sum);
+
+        [[nodiscard]] int size() const { return pool.size(); }
+    };
+
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#endif
+
+namespace PARALLEL
+{
+
+    /*
+     * Fixed set of worker threads that are kept alive between calls, so that small batches of work (e.g. the rollouts of one leaf)
+     * can be distributed without spawning threads each time. Only one parallelFor may run at a time.
+     */
+    class ThreadPool
+    {
+    private:
+        std::vector<std::thread> workers{};
+        std::mutex mutex{};
+        std::condition_variable work_available{};
+        std::condition_variable work_done{};
+
+        const std::function<void(int, int)>* task = nullptr;
+        int num_tasks = 0;
+        int next_task = 0;
+        int unfinished_tasks = 0;
+        unsigned long generation = 0; //Incremented for every parallelFor, so that workers notice new work
+        bool stop = false;
+        std::exception_ptr error = nullptr; //First exception thrown by a task of the running parallelFor
+
+        void work(int worker);
+
+    public:
+        explicit ThreadPool(int num_threads);
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+        ~ThreadPool();
+
+        // Calls task(i, worker) for all i in [0, n) on the pool's workers and returns once all calls finished.
+        // worker is the index of the executing thread in [0, size()) and can be used to select per-thread buffers.
+        // If a call throws, the tasks that have not started yet are skipped and the first exception is rethrown here.
+        void parallelFor(int n, const std::function<void(int task, int worker)>& task);
+
+        [[nodiscard]] int size() const { return static_cast<int>(workers.size()); }
+    };
+
+}
@@ -2,12 +2,13 @@
 
 #include <iostream>
 #include <cassert>
+#include <algorithm>
 #include <cstdlib>
 #include <cmath>
 #include <chrono>
 #include <queue>
 #include <fstream>
-#include <ranges>
+#include <stdexcept>
 
 using namespace Mcts;
 
@@ -24,71 +25,243 @@ MctsAgent::MctsAgent(const MctsArgs& args):
     a(args.a),
     b(args.b),
     puct(args.puct),
-    greedy_decision_policy(args.greedy_decision_policy)
-    {}
+    greedy_decision_policy(args.greedy_decision_policy),
+    threads(args.threads),
+    leaf_parallel(args.leaf_parallel),
+    shared_tree(args.shared_tree),
+    virtual_loss(args.virtual_loss)
+{
+    if (threads < 1)
+        throw std::runtime_error("[MctsAgent] threads must be at least 1");
+    if (shared_tree && leaf_parallel)
+        throw std::runtime_error("[MctsAgent] shared_tree and leaf_parallel are mutually exclusive");
+    if (shared_tree && wirsa)
+        throw std::runtime_error("[MctsAgent] wirsa is not supported for shared_tree");
+    if (threads > 1 && leaf_parallel && num_rollouts == 1)
+        throw std::runtime_error("[MctsAgent] leaf_parallel requires num_rollouts > 1");
+    if (threads > 1 && leaf_parallel)
+        rollout_pool = std::make_unique<PARALLEL::RolloutPool>(threads);
+    const int num_trees = threads > 1 && !leaf_parallel && !shared_tree? threads : 1;
+    for (int i = 0; i < num_trees; i++)
+        arenas.push_back(std::make_unique<POOL::TreeArena>(threads > 1 && shared_tree));
+    rollout_scratches.resize(threads > 1 && !leaf_parallel? threads : 1);
+}
+
+// Locks mutex only when searching a shared tree
+static std::unique_lock<std::mutex> lockIfShared(std::mutex& mutex, const MctsSearchStats& search_stats){
+    return search_stats.shared_tree_mutex == nullptr? std::unique_lock<std::mutex>() : std::unique_lock(mutex);
+}
+
+// Locks the global statistics of search_stats only when searching a shared tree
+static std::unique_lock<std::mutex> lockGlobalStats(const MctsSearchStats& search_stats){
+    return search_stats.shared_tree_mutex == nullptr? std::unique_lock<std::mutex>() : std::unique_lock(*search_stats.shared_tree_mutex);
+}
+
+// Sample states of a shared tree are heap copies, as the arena can only take back the last allocation of a single thread.
+// They are handed to the arena once they are stored in the tree.
+static void discardSampleState(ABS::Gamestate* sample_state, const MctsSearchStats& search_stats){
+    if (search_stats.shared_tree_mutex == nullptr)
+        search_stats.arena->destroyLast(sample_state);
+    else
+        delete sample_state;
+}
+
+static void storeSampleState(ABS::Gamestate* sample_state, const MctsSearchStats& search_stats){
+    if (search_stats.shared_tree_mutex != nullptr)
+        search_stats.arena->adopt(sample_state);
+}
 
 MctsNode* MctsAgent::buildTree(ABS::Model* model, ABS::Gamestate* state, MctsSearchStats& search_stats, std::mt19937& rng, bool determinize_env, bool determ_var_reduction){
+    return buildTree(model, state, search_stats, rng, budget, std::chrono::high_resolution_clock::now(), nullptr, *arenas[0], rollout_scratches[0], determinize_env, determ_var_reduction);
+}
 
-    const auto start = std::chrono::high_resolution_clock::now();
+/*
+ * Searches a new tree in arena until tree_budget is exhausted. If shared_forward_calls is given, forward calls are counted over all searches sharing it.
+ */
+MctsNode* MctsAgent::buildTree(ABS::Model* model, ABS::Gamestate* state, MctsSearchStats& search_stats, std::mt19937& rng, const MctsBudget& tree_budget,
+                               const std::chrono::high_resolution_clock::time_point start, std::atomic<long>* shared_forward_calls, POOL::TreeArena& arena, PARALLEL::RolloutScratch& scratch,
+                               bool determinize_env, bool determ_var_reduction){
 
-    auto init_state = model->copyState(state);
-    auto* root = new MctsNode(model, init_state,0,  rng);
-    std::map<int,gsToNodeMap<MctsNode*>> layerMap = {};
+    auto init_state = copyStateToArena(model, state, arena);
+    auto* root = arena.createUntracked<MctsNode>(model, init_state, 0, rng, &arena);
+    TranspositionTable transpositions;
     if(dag)
-        layerMap = {{0,{{init_state,root}}}};
-    search_stats = {budget, 0, 0, 0, &layerMap,std::vector<double>(model->getNumPlayers(), 0), std::vector<double>(model->getNumPlayers(),0),0, determinize_env, determ_var_reduction, {}, determinize_env? std::uniform_int_distribution<int>(0, 10000000)(rng) : 0};
+        transpositions.insert(0, init_state, root);
+    search_stats = {tree_budget, 0, 0, 0, &transpositions,std::vector<double>(model->getNumPlayers(), 0), std::vector<double>(model->getNumPlayers(),0),0, determinize_env, determ_var_reduction, {}, determinize_env? std::uniform_int_distribution<int>(0, 10000000)(rng) : 0};
+    search_stats.arena = &arena;
     const int total_forward_calls_before = model->getForwardCalls();
+    long budget_forward_calls = 0;
+
+    if (rollout_pool != nullptr)
+        rollout_pool->attach(model);
 
     while ( // Within budget
-        (budget.quantity == "iterations" && search_stats.completed_iterations < budget.amount) ||
-        (budget.quantity == "forward_calls" && search_stats.total_forward_calls < budget.amount) ||
-        (budget.quantity == "milliseconds" && std::chrono::duration<double, std::milli>(
-            std::chrono::high_resolution_clock::now() - start).count() < budget.amount)
+        (tree_budget.quantity == "iterations" && search_stats.completed_iterations < tree_budget.amount) ||
+        (tree_budget.quantity == "forward_calls" && budget_forward_calls < tree_budget.amount) ||
+        (tree_budget.quantity == "milliseconds" && std::chrono::duration<double, std::milli>(
+            std::chrono::high_resolution_clock::now() - start).count() < tree_budget.amount)
     ){
         // MCTS with forward calls cond can end in infinite loop
         auto leaf_path = treePolicy(model, root, rng, search_stats);
-        const auto rewards = rollout(model, std::get<0>(leaf_path.back()), rng);
+        const auto rewards = rollout(model, std::get<0>(leaf_path.back()), rng, scratch);
         backup(rewards,leaf_path, search_stats);
 
         search_stats.completed_iterations++;
-        search_stats.total_forward_calls = model->getForwardCalls() - total_forward_calls_before;
+        const int forward_calls = model->getForwardCalls() - total_forward_calls_before;
+        budget_forward_calls = forward_calls;
+        if (shared_forward_calls != nullptr)
+            budget_forward_calls = shared_forward_calls->fetch_add(forward_calls - search_stats.total_forward_calls) + (forward_calls - search_stats.total_forward_calls);
+        search_stats.total_forward_calls = forward_calls;
     }
+
+    if (rollout_pool != nullptr)
+        rollout_pool->detach();
+
     return root;
 }
 
-void MctsAgent::cleanupTree(MctsNode* root){
-    //cleanup tree
-    std::vector<MctsNode*> clear_stack = {root};
-    std::set<MctsNode*> to_clear_nodes = {root};
-    while(!clear_stack.empty()){
-        auto next = clear_stack.back();
-        clear_stack.pop_back();
-        for (auto& q_state : std::views::values(*next->getChildren())){
-            for (const auto& child_state_node : std::views::values(q_state)){
-                if(!to_clear_nodes.contains(child_state_node)){
-                    clear_stack.push_back(child_state_node);
-                    to_clear_nodes.insert(child_state_node);
-                }
-            }
-        }
-    }
-
-    delete root->getState();
-    for(auto* node : to_clear_nodes){
-        for (auto& q_state : std::views::values(*node->getChildren())){
-            for (const auto& gamestate : std::views::keys(q_state))
-               delete gamestate;
-        }
-        delete node;
-    }
+// The nodes only hold memory of their arena, so only the states need to be destroyed
+void MctsAgent::cleanupTree(){
+    for (const auto& arena : arenas)
+        arena->reset();
 }
 
 
 int MctsAgent::getAction(ABS::Model* model, ABS::Gamestate* state, std::mt19937& rng){
+    if (threads > 1 && shared_tree)
+        return getSharedTreeAction(model, state, rng);
+    if (threads > 1 && !leaf_parallel)
+        return getRootParallelAction(model, state, rng);
+
     MctsSearchStats search_stats;
     auto root = buildTree(model, state, search_stats, rng);
-    const int best_action = greedy_decision_policy? selectAction(root, true, rng, search_stats) : sampleAction(root, rng);
-    cleanupTree(root);
+    const int best_action = root->getTriedAction(greedy_decision_policy? selectAction(root, true, rng, search_stats) : sampleAction(root, rng));
+    cleanupTree();
+    return best_action;
+}
+
+/*
+ * Root parallelization: Every worker searches its own tree with a random stream forked from rng. The first worker uses the given model,
+ * all others a clone of it.
+ * An iteration budget is split among the workers and a forward call budget is shared by them.
+ */
+int MctsAgent::getRootParallelAction(ABS::Model* model, ABS::Gamestate* state, std::mt19937& rng){
+
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    const auto worker_budgets = PARALLEL::splitBudget(budget, threads);
+    const int num_workers = static_cast<int>(worker_budgets.size());
+    const PARALLEL::ModelClones models(model, num_workers, true);
+    auto rngs = PARALLEL::forkRngs(rng, num_workers);
+
+    std::vector<MctsNode*> roots(num_workers, nullptr);
+    std::vector<MctsSearchStats> worker_stats(num_workers);
+    std::atomic<long> shared_forward_calls = 0;
+    PARALLEL::runWorkers(num_workers, [&](const int i) {
+        roots[i] = buildTree(models[i], state, worker_stats[i], rngs[i], worker_budgets[i], start, &shared_forward_calls, *arenas[i], rollout_scratches[i], false, false);
+    });
+
+    const int best_action = selectMergedAction(roots, rng);
+    cleanupTree();
+    return best_action;
+}
+
+/*
+ * Tree parallelization: All workers search the same tree, each on its own model clone with a random stream forked from rng.
+ * Every node has its own mutex, which is only held while selecting, expanding or updating it, and the transposition table of
+ * the DAG mode is sharded, so that the workers rarely wait for each other. The actions of a trajectory carry a virtual loss
+ * until it is backed up, so that the other workers prefer different paths.
+ */
+int MctsAgent::getSharedTreeAction(ABS::Model* model, ABS::Gamestate* state, std::mt19937& rng){
+
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    const PARALLEL::ModelClones models(model, threads);
+    auto rngs = PARALLEL::forkRngs(rng, threads);
+
+    auto& arena = *arenas[0];
+    auto init_state = copyStateToArena(model, state, arena);
+    auto* root = arena.createUntracked<MctsNode>(model, init_state, 0, rng, &arena);
+    TranspositionTable transpositions;
+    if(dag)
+        transpositions.insert(0, init_state, root);
+    std::mutex stats_mutex;
+    MctsSearchStats search_stats = {budget, 0, 0, 0, &transpositions, std::vector<double>(model->getNumPlayers(), 0), std::vector<double>(model->getNumPlayers(),0), 0, false, false, {}, 0, &stats_mutex, &arena};
+
+    std::atomic<int> started_iterations = 0;
+    std::atomic<int> completed_iterations = 0;
+    std::atomic<long> shared_forward_calls = 0;
+    std::vector<int> max_depths(threads, 0); //Per worker, so that the workers do not lock the global stats for it
+    PARALLEL::runWorkers(threads, [&](const int i) {
+        long forward_calls_before = models[i]->getForwardCalls();
+        while ( // Within budget
+            (budget.quantity == "iterations" && started_iterations.fetch_add(1) < budget.amount) ||
+            (budget.quantity == "forward_calls" && shared_forward_calls.load() < budget.amount) ||
+            (budget.quantity == "milliseconds" && std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - start).count() < budget.amount)
+        ){
+            auto leaf_path = treePolicy(models[i], root, rngs[i], search_stats);
+            max_depths[i] = std::max(max_depths[i], std::get<0>(leaf_path.back())->getDepth());
+            const auto rewards = rollout(models[i], std::get<0>(leaf_path.back()), rngs[i], rollout_scratches[i]);
+            backup(rewards, leaf_path, search_stats);
+
+            completed_iterations++;
+            const long forward_calls = models[i]->getForwardCalls();
+            shared_forward_calls += forward_calls - forward_calls_before;
+            forward_calls_before = forward_calls;
+        }
+    });
+    search_stats.completed_iterations = completed_iterations;
+    search_stats.total_forward_calls = static_cast<int>(shared_forward_calls);
+    search_stats.max_depth = *std::ranges::max_element(max_depths);
+
+    const int best_action = root->getTriedAction(greedy_decision_policy? selectAction(root, true, rng, search_stats) : sampleAction(root, rng));
+    cleanupTree();
+    return best_action;
+}
+
+// Decision of a root-parallel search, based on the summed action statistics of all roots
+int MctsAgent::selectMergedAction(const std::vector<MctsNode*>& roots, std::mt19937& rng) const{
+
+    struct MergedStats {
+        double visits = 0;
+        double values = 0;
+    };
+    const int player = roots[0]->getPlayer();
+    std::map<int, MergedStats> merged_stats;
+    for (const auto* root : roots) {
+        for (int idx = 0; idx < root->getNumTriedActions(); idx++) {
+            const double values = root->getActionValues(idx)[player];
+            auto [it, inserted] = merged_stats.try_emplace(root->getTriedAction(idx), MergedStats{0, values});
+            it->second.visits += root->getActionVisits(idx);
+            if (!inserted)
+                it->second.values = max_backup? std::max(it->second.values, values) : it->second.values + values;
+        }
+    }
+
+    if (!greedy_decision_policy) {
+        //sample proportional to visit count
+        std::vector<int> actions;
+        std::vector<double> visits;
+        for (const auto& [action, stats] : merged_stats) {
+            actions.push_back(action);
+            visits.push_back(stats.visits);
+        }
+        std::discrete_distribution<> dist(visits.begin(), visits.end());
+        return actions[dist(rng)];
+    }
+
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    double best_value = -std::numeric_limits<double>::infinity();
+    int best_action = -42;
+    for (const auto& [action, stats] : merged_stats) {
+        const double value = stats.values / (max_backup? 1.0 : stats.visits) + TIEBREAKER_NOISE * dist(rng); //trick to efficiently break ties
+        if (value > best_value) {
+            best_value = value;
+            best_action = action;
+        }
+    }
+    assert (best_action != -42);
     return best_action;
 }
 
@@ -97,23 +270,31 @@ std::vector<std::tuple<MctsNode*,int,std::vector<double>>> MctsAgent::treePolicy
     std::vector<std::tuple<MctsNode*,int,std::vector<double>>>  state_action_reward_path;
     auto old_node = node;
     while (!node->isTerminal() && !reached_leaf){
-        int chosen_action;
+        int chosen_idx;
         std::vector<double> rewards;
-        node = selectNode(model, node, reached_leaf, chosen_action, rewards, rng, search_stats);
-        state_action_reward_path.emplace_back(old_node,chosen_action, rewards);
+        node = selectNode(model, node, reached_leaf, chosen_idx, rewards, rng, search_stats);
+        state_action_reward_path.emplace_back(old_node,chosen_idx, rewards);
         old_node = node;
-        if (node->getDepth() > search_stats.max_depth)
-            search_stats.max_depth = node->getDepth();
     }
+    if (search_stats.shared_tree_mutex == nullptr && node->getDepth() > search_stats.max_depth) //The workers of a shared tree track it themselves
+        search_stats.max_depth = node->getDepth();
     state_action_reward_path.push_back({node,-1,{}});
     return state_action_reward_path;
 }
 
-MctsNode* MctsAgent::selectNode(ABS::Model* model, MctsNode* node, bool& reached_leaf, int& chosen_action, std::vector<double>& rewards,  std::mt19937& rng, MctsSearchStats& search_stats)
+MctsNode* MctsAgent::selectNode(ABS::Model* model, MctsNode* node, bool& reached_leaf, int& chosen_idx, std::vector<double>& rewards,  std::mt19937& rng, MctsSearchStats& search_stats)
 {
     reached_leaf = false;
-    chosen_action = node->isFullyExpanded()? selectAction(node, false, rng, search_stats) : node->popUntriedAction(max_backup? -std::numeric_limits<double>::infinity() : 0.0);
-    auto sample_state = node->getStateCopy();
+    const bool shared = search_stats.shared_tree_mutex != nullptr;
+    auto node_lock = lockIfShared(node->getMutex(), search_stats);
+    chosen_idx = node->isFullyExpanded()? selectAction(node, false, rng, search_stats) : node->popUntriedAction(max_backup? -std::numeric_limits<double>::infinity() : 0.0);
+    const int chosen_action = node->getTriedAction(chosen_idx);
+    auto& successors = node->getChildren(chosen_idx);
+    if (shared) {
+        node->addVirtualLoss(chosen_idx, max_backup? 0.0 : virtual_loss);
+        node_lock.unlock();
+    }
+    auto sample_state = shared? node->getStateCopy(model) : node->getStateCopy(model, *search_stats.arena);
 
     int determ_seed=0;
     if(search_stats.deterministic_env)
@@ -133,11 +314,11 @@ MctsNode* MctsAgent::selectNode(ABS::Model* model, MctsNode* node, bool& reached
     auto [rewards_tmp, probability] = model->applyAction(sample_state, chosen_action, search_stats.deterministic_env? determ_action_rng : rng, nullptr);
     rewards = rewards_tmp;
 
-    if(wirsa && node->getActionVisits(chosen_action) > 0) {
+    if(wirsa && node->getActionVisits(chosen_idx) > 0) {
         //get nearest neighbor of outcome state
         MctsNode* nearest_neighbor = nullptr;
         double min_distance = std::numeric_limits<double>::infinity();
-        for(auto& [outcome, child] : (*node->getChildren())[chosen_action]){
+        for(auto& [outcome, child] : successors){
             double distance = model->getDistance(sample_state,child->getState());
             if(distance < min_distance){
                 min_distance = distance;
@@ -147,158 +328,178 @@ MctsNode* MctsAgent::selectNode(ABS::Model* model, MctsNode* node, bool& reached
         assert (nearest_neighbor != nullptr);
         double eps = a * pow(nearest_neighbor->getVisits(),b);
         if(min_distance < eps) {
-            delete sample_state;
+            discardSampleState(sample_state, search_stats);
             return nearest_neighbor;
         }
     }
 
-    const auto* successors = &node->getChildren()->at(chosen_action);
-    if (!node->getChildren()->at(chosen_action).contains(sample_state)){
+    if (shared)
+        node_lock.lock();
+    if (!successors.contains(sample_state)){
 
-        assert (!search_stats.deterministic_env || node->getActionVisits(chosen_action) == 0);
+        assert (!search_stats.deterministic_env || node->getActionVisits(chosen_idx) == 0);
         // New successor sampled
-        if(dag && (*search_stats.layerMap)[node->getDepth()+1].contains(sample_state))
+        if(dag)
+        {
+            if (auto* known_node = search_stats.transpositions->find(node->getDepth()+1, sample_state); known_node != nullptr) {
+                storeSampleState(sample_state, search_stats);
+                successors[sample_state] = known_node;
+                return known_node;
+            }
+        }
+        storeSampleState(sample_state, search_stats);
+        auto* new_leaf = search_stats.arena->createUntracked<MctsNode>(model, sample_state, node->getDepth() + 1, rng, search_stats.arena);
+        if(dag)
         {
-            auto* new_leaf = (*search_stats.layerMap)[node->getDepth()+1][sample_state];
-            (*node->getChildren())[chosen_action][sample_state] = new_leaf;
-            return new_leaf;
-        }else{
-            auto* new_leaf = new MctsNode(model, sample_state, node->getDepth() + 1, rng);
-            reached_leaf = true;
-            if(dag)
-                (*search_stats.layerMap)[node->getDepth()+1][sample_state] = new_leaf;
-            (*node->getChildren())[chosen_action][sample_state] = new_leaf;
-            return new_leaf; //we dont delete sample state here because it has to be saved in the new node
+            // In a shared tree, another worker may have added the state meanwhile. The unused node stays in the arena.
+            if (auto* stored_node = search_stats.transpositions->insert(node->getDepth()+1, sample_state, new_leaf); stored_node != new_leaf) {
+                successors[sample_state] = stored_node;
+                return stored_node;
+            }
         }
+        reached_leaf = true;
+        successors[sample_state] = new_leaf;
+        return new_leaf; //we dont delete sample state here because it has to be saved in the new node
     }
 
     // Already sampled successor
-    auto successor = successors->at(sample_state);
-    delete sample_state;
+    auto successor = successors.at(sample_state);
+    discardSampleState(sample_state, search_stats);
     return successor;
 }
 
 int MctsAgent::sampleAction(MctsNode* node,std::mt19937& rng)
 {
     //sample proportional to visit count
+    const int num_actions = node->getNumTriedActions();
     double total_visits = 0.0;
-    for (const int action : *node->getTriedActions())
-        total_visits += node->getActionVisits(action);
+    for (int idx = 0; idx < num_actions; idx++)
+        total_visits += node->getActionVisits(idx);
 
-    std::vector<double> probs = std::vector<double>(node->getTriedActions()->size(), 0.0);
-    int idx = 0;
-    for (const int action : *node->getTriedActions())
-        probs[idx++] = node->getActionVisits(action) / (double)total_visits;
+    std::vector<double> probs = std::vector<double>(num_actions, 0.0);
+    for (int idx = 0; idx < num_actions; idx++)
+        probs[idx] = node->getActionVisits(idx) / (double)total_visits;
 
     std::discrete_distribution<> dist(probs.begin(), probs.end());
-    int sampled_action = (*node->getTriedActions())[dist(rng)];
-    return sampled_action;
+    return dist(rng);
 }
 
 int MctsAgent::selectAction(MctsNode* node, bool greedy, std::mt19937& rng, MctsSearchStats& search_stats)
 {
     // UCT Formula: w/n + c * sqrt(ln(N)/n)
-    assert(!node->getTriedActions()->empty());
-
-    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    assert(node->getNumTriedActions() > 0);
 
-    // Determine action
-    const double node_visits = node->getVisits();
-
-    double best_value = -std::numeric_limits<double>::infinity();
-    int best_action = -42;
+    // Determine action, in a shared tree with the virtual losses of the in-flight trajectories
+    const bool shared = search_stats.shared_tree_mutex != nullptr;
+    const double node_visits = shared? node->getVisits() + node->getVirtualVisits() : node->getVisits();
 
     //For local std calculation
     double dynamic_exp_factor = 1;
     if(dynamic_exploration_factor){
+        const auto stats_lock = lockGlobalStats(search_stats);
         const double var = std::max(0.0,search_stats.total_squared_v[node->getPlayer()] / search_stats.global_num_vs - (search_stats.total_v[node->getPlayer()] / search_stats.global_num_vs) *  (search_stats.total_v[node->getPlayer()] / search_stats.global_num_vs));
         dynamic_exp_factor = sqrt(var);
     }
 
-    for (const int action : *node->getTriedActions()){
-        const auto action_values = node->getActionValues(action);
-        const double action_visits = node->getActionVisits(action);
-        const double exploration_term = puct? (sqrt(node_visits) / (1 + action_visits)) : (sqrt(log(node_visits) / action_visits));
-        const double q_value = action_values->at(node->getPlayer()) / (max_backup? 1.0 : action_visits);
-
-        double exploration_param = node->getDepth() >= static_cast<int>(exploration_parameters.size()) ? exploration_parameters.back() : exploration_parameters[node->getDepth()];
-        double score;
-        if(exploration_param == -1 && !greedy) //greedy overwrites uniform
-            score = exploration_term;
-        else
-            score = q_value + (greedy? 0 : exploration_param * exploration_term * dynamic_exp_factor);
-        score += TIEBREAKER_NOISE * dist(rng); //trick to efficiently break ties
-        if (score > best_value){
-            best_value = score;
-            best_action = action;
-        }
-    }
-
-    return best_action;
+    const double exploration_param = node->getDepth() >= static_cast<int>(exploration_parameters.size()) ? exploration_parameters.back() : exploration_parameters[node->getDepth()];
+    const UctScoreParams params{
+        .puct = puct,
+        .greedy = greedy,
+        .uniform = exploration_param == -1 && !greedy, //greedy overwrites uniform
+        .numerator = puct? sqrt(node_visits) : log(node_visits),
+        .exploration_factor = exploration_param * dynamic_exp_factor,
+        .max_backup = max_backup,
+        .noise_key = static_cast<uint32_t>(rng()), //one draw for the tiebreak noise of all actions
+        .noise_scale = TIEBREAKER_NOISE
+    };
+    return selectBestAction(node->getAllActionVisits(), node->getAllActionValues(), shared? node->getAllActionVirtualVisits() : nullptr,
+                            shared? node->getAllActionVirtualValues() : nullptr, node->getNumPlayers(), node->getPlayer(), node->getNumTriedActions(), params);
 }
 
-std::vector<double> MctsAgent::rollout(ABS::Model* model, MctsNode* node, std::mt19937& rng) const
+std::vector<double> MctsAgent::rollout(ABS::Model* model, MctsNode* node, std::mt19937& rng, PARALLEL::RolloutScratch& scratch)
 {
-    auto reward_sum = std::vector<double>(model->getNumPlayers(), 0);
+    const int num_players = model->getNumPlayers();
+    auto reward_sum = std::vector<double>(num_players, 0);
     if (node->isTerminal())
     {
         return reward_sum;
     }
 
-    for(int i = 0; i < num_rollouts; i++) {
-        double total_discount = 1;
-        auto* rollout_state = node->getStateCopy();
-        int episode_steps = 0;
-        while (!rollout_state->terminal && (rollout_length == -1 || episode_steps < rollout_length))
-        {
-            // Sample action
-            auto available_actions = model->getActions(rollout_state);
-            std::uniform_int_distribution<int> dist(0, static_cast<int>(available_actions.size()) - 1);
-            const int action = available_actions[dist(rng)];
-
-            // Apply action and get rewards
-            auto [rewards, probability] = model->applyAction(rollout_state, action,rng, nullptr);
-            for (size_t player = 0; player < rewards.size(); player++)
-            {
-                reward_sum[player] += rewards[player] * total_discount * (1 / (double) num_rollouts);
-            }
-            total_discount *= discount;
-            episode_steps++;
-        }
-        delete rollout_state;
+    if (rollout_pool == nullptr) {
+        for(int i = 0; i < num_rollouts; i++)
+            playRollout(model, node, rng, reward_sum.data(), scratch);
+    } else {
+        rollout_pool->playRollouts(num_rollouts, num_players, rng, [&](ABS::Model* rollout_model, std::mt19937& rollout_rng, double* rewards, PARALLEL::RolloutScratch& worker_scratch) {
+            playRollout(rollout_model, node, rollout_rng, rewards, worker_scratch);
+        }, reward_sum.data());
     }
 
     return reward_sum;
 }
 
+// Plays one random rollout from node and adds its discounted rewards, divided by num_rollouts, to reward_sum
+void MctsAgent::playRollout(ABS::Model* model, const MctsNode* node, std::mt19937& rng, double* reward_sum, PARALLEL::RolloutScratch& scratch) const
+{
+    double total_discount = 1;
+    auto* rollout_state = scratch.copyState(model, node->getState());
+    auto& available_actions = scratch.actions;
+    int episode_steps = 0;
+    while (!rollout_state->terminal && (rollout_length == -1 || episode_steps < rollout_length))
+    {
+        // Sample action
+        model->getActions(rollout_state, available_actions);
+        std::uniform_int_distribution<int> dist(0, static_cast<int>(available_actions.size()) - 1);
+        const int action = available_actions[dist(rng)];
+
+        // Apply action and get rewards
+        auto [rewards, probability] = model->applyAction(rollout_state, action,rng, nullptr);
+        for (size_t player = 0; player < rewards.size(); player++)
+        {
+            reward_sum[player] += rewards[player] * total_discount * (1 / (double) num_rollouts);
+        }
+        total_discount *= discount;
+        episode_steps++;
+    }
+    scratch.release(rollout_state);
+}
+
 void MctsAgent::backup(std::vector<double> values, std::vector<std::tuple<MctsNode*,int,std::vector<double>>>& path, MctsSearchStats& search_stats) const
 {
     for (size_t i = path.size()-1; i >= 1; i--)
     {
         auto parent = std::get<0>(path[i-1]);
-        auto parent_action = std::get<1>(path[i-1]);
+        auto parent_idx = std::get<1>(path[i-1]);
         auto rewards = std::get<2>(path[i-1]);
 
         for (size_t player = 0; player < values.size(); player++)
             values[player] = values[player] * discount + rewards[player];
 
-        for (size_t player = 0; player < values.size(); player++) {
-            if(parent->getActionVisits(parent_action) >= 1) { //only remove value if it was present before
-                double old_q = parent->getActionValues(parent_action)->at(player) / (max_backup? 1.0 : ((double) parent->getActionVisits(parent_action)));
+        const auto node_lock = lockIfShared(parent->getMutex(), search_stats);
+        if (search_stats.shared_tree_mutex != nullptr)
+            parent->removeVirtualLoss(parent_idx, max_backup? 0.0 : virtual_loss);
+
+        // The global q statistics are only needed for the dynamic exploration factor
+        const auto stats_lock = dynamic_exploration_factor? lockGlobalStats(search_stats) : std::unique_lock<std::mutex>();
+        if (dynamic_exploration_factor && parent->getActionVisits(parent_idx) >= 1) { //only remove value if it was present before
+            for (size_t player = 0; player < values.size(); player++) {
+                double old_q = parent->getActionValues(parent_idx)[player] / (max_backup? 1.0 : ((double) parent->getActionVisits(parent_idx)));
                 search_stats.total_v[player] -= old_q;
                 search_stats.total_squared_v[player] -= old_q * old_q;
             }
         }
 
         parent->addVisit();
-        parent->addActionVisit(parent_action);
-        parent->addActionValues(parent_action, values, max_backup);
+        parent->addActionVisit(parent_idx);
+        parent->addActionValues(parent_idx, values, max_backup);
+
+        if (!dynamic_exploration_factor)
+            continue;
 
-        if(parent->getActionVisits(parent_action) == 1)
+        if(parent->getActionVisits(parent_idx) == 1)
             search_stats.global_num_vs++;
 
         for (size_t player = 0; player < values.size(); player++){
-            double q = parent->getActionValues(parent_action)->at(player) / (max_backup? 1.0 : (double) parent->getActionVisits(parent_action));
+            double q = parent->getActionValues(parent_idx)[player] / (max_backup? 1.0 : (double) parent->getActionVisits(parent_idx));
             search_stats.total_v[player] += q;
             search_stats.total_squared_v[player] += q*q;
         }
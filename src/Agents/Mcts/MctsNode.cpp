@@ -1,6 +1,7 @@
 #include <utility>
 #include <random>
 #include <algorithm>
+#include <cstddef>
 #include <ranges>
 #include "../../../include/Agents/Mcts/MctsNode.h"
 
@@ -10,21 +11,35 @@ MctsNode::MctsNode(
     ABS::Model* model,
     ABS::Gamestate* state,
     int depth,
-    std::mt19937& rng
-): model(model), state(state), depth(depth){
+    std::mt19937& rng,
+    std::pmr::memory_resource* memory
+): model(model), state(state), num_players(model->getNumPlayers()), depth(depth),
+   tried_actions(memory), action_visits(memory), action_values(memory), action_virtual_visits(memory), action_virtual_values(memory), children(memory),
+   untried_actions(memory){
     visits = 0;
-    untried_actions = state->terminal? std::vector<int>() : model->getActions(state);
+    if (!state->terminal) {
+        const auto actions = model->getActions(state);
+        untried_actions.assign(actions.begin(), actions.end());
+    }
     std::ranges::shuffle(untried_actions.begin(), untried_actions.end(), rng);
+    tried_actions.reserve(untried_actions.size());
+    action_visits.reserve(untried_actions.size());
+    action_values.reserve(untried_actions.size() * num_players);
+    action_virtual_visits.reserve(untried_actions.size());
+    action_virtual_values.reserve(untried_actions.size());
+    children.reserve(untried_actions.size());
 }
 
 int MctsNode::popUntriedAction(double vinit){
     int a = untried_actions.back();
     untried_actions.pop_back();
     tried_actions.push_back(a);
-    action_values[a] = std::vector<double>(model->getNumPlayers(), vinit);
-    action_visits[a] = 0;
-    children[a] = {};
-    return a;
+    action_values.insert(action_values.end(), num_players, vinit);
+    action_visits.push_back(0);
+    action_virtual_visits.push_back(0);
+    action_virtual_values.push_back(0);
+    children.emplace_back();
+    return static_cast<int>(tried_actions.size()) - 1;
 }
 
 void MctsNode::addVisit()
@@ -32,21 +47,36 @@ void MctsNode::addVisit()
     visits++;
 }
 
-void MctsNode::addActionVisit(const int action)
+void MctsNode::addActionVisit(const int idx)
 {
-    action_visits[action]++;
+    action_visits[idx]++;
 }
 
-void MctsNode::addActionValues(const int action, const std::vector<double>& values, bool max_backup)
+void MctsNode::addActionValues(const int idx, const std::vector<double>& values, bool max_backup)
 {
+    double* idx_values = &action_values[idx * num_players];
     for (size_t i = 0; i < values.size(); i++) {
         if (max_backup)
-            action_values[action][i] = std::max(action_values[action][i], values[i]);
+            idx_values[i] = std::max(idx_values[i], values[i]);
         else
-            action_values[action][i] += values[i];
+            idx_values[i] += values[i];
     }
 }
 
+void MctsNode::addVirtualLoss(const int idx, const double loss)
+{
+    virtual_visits++;
+    action_virtual_visits[idx]++;
+    action_virtual_values[idx] -= loss;
+}
+
+void MctsNode::removeVirtualLoss(const int idx, const double loss)
+{
+    virtual_visits--;
+    // Reset once no loss is left, so that no rounding residue remains
+    action_virtual_values[idx] = --action_virtual_visits[idx] == 0? 0 : action_virtual_values[idx] + loss;
+}
+
 bool MctsNode::isFullyExpanded() const
 {
     return untried_actions.empty();
@@ -62,39 +92,42 @@ ABS::Model* MctsNode::getModel() const
     return model;
 }
 
-std::vector<double>* MctsNode::getActionValues(const int action)
+const std::pmr::vector<int>& MctsNode::getTriedActions() const
 {
-    return &action_values[action];
+    return tried_actions;
 }
 
-int MctsNode::getActionVisits(const int action)
+int MctsNode::getVisits() const
 {
-    return action_visits[action];
+    return visits;
 }
 
-std::vector<int>* MctsNode::getTriedActions()
+bool MctsNode::isTerminal() const
 {
-    return &tried_actions;
+    return state->terminal;
 }
 
-std::map<int, gsToNodeMap<MctsNode*>>* MctsNode::getChildren()
+ABS::Gamestate* MctsNode::getStateCopy() const
 {
-    return &children;
+    return model->copyState(state);
 }
 
-int MctsNode::getVisits() const
+ABS::Gamestate* MctsNode::getStateCopy(ABS::Model* model) const
 {
-    return visits;
+    return model->copyState(state);
 }
 
-bool MctsNode::isTerminal() const
+ABS::Gamestate* MctsNode::getStateCopy(ABS::Model* model, POOL::TreeArena& arena) const
 {
-    return state->terminal;
+    return copyStateToArena(model, state, arena);
 }
 
-ABS::Gamestate* MctsNode::getStateCopy() const
+ABS::Gamestate* Mcts::copyStateToArena(ABS::Model* model, ABS::Gamestate* state, POOL::TreeArena& arena)
 {
-    return model->copyState(state);
+    const size_t size = model->getStateSize();
+    if (size == 0)
+        return arena.adopt(model->copyState(state));
+    return arena.construct<ABS::Gamestate>(size, alignof(std::max_align_t), [&](void* memory) { return model->copyStateInto(state, memory); });
 }
 
 int MctsNode::getPlayer() const
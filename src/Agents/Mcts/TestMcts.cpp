@@ -0,0 +1,177 @@
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "../../../include/Agents/Mcts/MctsAgent.h"
+#include "../../../include/Agents/Mcts/UctKernel.h"
+#include "../../../include/Utils/UnitTest.h"
+
+namespace Mcts
+{
+    /*
+     * Test that the AVX2 and the scalar UCT kernel select the same action on random statistics, for one and several players,
+     * all score variants, with and without virtual losses and action counts that are not multiples of the vector width.
+     */
+    void uctKernelTest()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        if (!hasAvx2()) {
+            std::cout << "- UCT kernel test skipped, the CPU does not support AVX2" << std::endl;
+            return;
+        }
+
+        auto rng = std::mt19937(42);
+        std::uniform_int_distribution<int> visit_dist(1, 50);
+        std::uniform_real_distribution<double> value_dist(-10, 10);
+        std::uniform_int_distribution<int> coarse_value_dist(-2, 2); //Produces many ties
+        std::uniform_int_distribution<int> virtual_visit_dist(0, 3);
+        std::uniform_int_distribution<uint32_t> key_dist;
+
+        bool same_uct = true, same_puct = true, same_uniform = true, same_greedy = true, same_max_backup = true, same_ties = true;
+        bool valid_idx = true;
+        for (int num_players = 1; num_players <= 3; num_players++) {
+            for (int num_actions = 1; num_actions <= 13; num_actions++) {
+                for (int repetition = 0; repetition < 20; repetition++) {
+                    const bool coarse = repetition % 2 == 1;
+                    std::vector<int> visits(num_actions);
+                    std::vector<double> values(num_actions * num_players);
+                    for (auto& v : visits)
+                        v = coarse ? 10 : visit_dist(rng);
+                    for (auto& v : values)
+                        v = coarse ? coarse_value_dist(rng) : value_dist(rng);
+                    std::vector<int> virtual_visits(num_actions);
+                    std::vector<double> virtual_values(num_actions);
+                    for (int idx = 0; idx < num_actions; idx++) {
+                        virtual_visits[idx] = virtual_visit_dist(rng);
+                        virtual_values[idx] = -1.0 * virtual_visits[idx];
+                    }
+                    const int player = std::uniform_int_distribution<int>(0, num_players - 1)(rng);
+                    const int total_visits = std::accumulate(visits.begin(), visits.end(), 0);
+
+                    auto same = [&](const UctScoreParams& params) {
+                        bool same_action = true;
+                        for (const bool with_virtual : {false, true}) {
+                            const int* v_visits = with_virtual ? virtual_visits.data() : nullptr;
+                            const double* v_values = with_virtual ? virtual_values.data() : nullptr;
+                            const int scalar = selectBestActionScalar(visits.data(), values.data(), v_visits, v_values, num_players, player, num_actions, params);
+                            const int avx2 = selectBestActionAvx2(visits.data(), values.data(), v_visits, v_values, num_players, player, num_actions, params);
+                            valid_idx = valid_idx && scalar >= 0 && scalar < num_actions
+                                && selectBestAction(visits.data(), values.data(), v_visits, v_values, num_players, player, num_actions, params) == scalar;
+                            same_action = same_action && scalar == avx2;
+                        }
+                        return same_action;
+                    };
+
+                    // Without noise the coarse statistics tie, with noise the tiebreak noise has to be the same in both kernels
+                    for (const double noise_scale : {0.0, 1e-6}) {
+                        UctScoreParams params{.numerator = std::log(total_visits), .exploration_factor = 1.5, .noise_key = key_dist(rng), .noise_scale = noise_scale};
+                        same_uct = same_uct && same(params);
+                        params.max_backup = true;
+                        same_max_backup = same_max_backup && same(params);
+                        params.max_backup = false;
+                        params.puct = true;
+                        params.numerator = std::sqrt(total_visits);
+                        same_puct = same_puct && same(params);
+                        params.uniform = true;
+                        same_uniform = same_uniform && same(params);
+                        params.uniform = false;
+                        params.greedy = true;
+                        same_greedy = same_greedy && same(params);
+                    }
+
+                    // Identical actions, the first one is selected
+                    std::vector<int> tie_visits(num_actions, 7);
+                    std::vector<double> tie_values(num_actions * num_players, 3.0);
+                    const UctScoreParams tie_params{.numerator = std::log(7.0 * num_actions)};
+                    same_ties = same_ties && selectBestActionScalar(tie_visits.data(), tie_values.data(), nullptr, nullptr, num_players, player, num_actions, tie_params) == 0
+                        && selectBestActionAvx2(tie_visits.data(), tie_values.data(), nullptr, nullptr, num_players, player, num_actions, tie_params) == 0;
+                }
+            }
+        }
+        ASSERT_TRUE(same_uct);
+        ASSERT_TRUE(same_puct);
+        ASSERT_TRUE(same_uniform);
+        ASSERT_TRUE(same_greedy);
+        ASSERT_TRUE(same_max_backup);
+        ASSERT_TRUE(same_ties);
+        ASSERT_TRUE(valid_idx);
+
+        // No action with a score above -infinity
+        const std::vector<int> visits(6, 1);
+        const std::vector<double> values(6, -std::numeric_limits<double>::infinity());
+        const UctScoreParams params{.greedy = true};
+        ASSERT_EQUALS(-42, selectBestActionScalar(visits.data(), values.data(), nullptr, nullptr, 1, 0, 6, params));
+        ASSERT_EQUALS(-42, selectBestActionAvx2(visits.data(), values.data(), nullptr, nullptr, 1, 0, 6, params));
+
+        std::cout << "- UCT kernel test done" << std::endl;
+#else
+        std::cout << "- UCT kernel test skipped, no AVX2 kernel on this architecture" << std::endl;
+#endif
+    }
+
+    /*
+     * Test that a TreeArena destroys its tracked objects on reset, deletes adopted ones and that destroyLast only takes back the memory
+     * of the last object while nothing was allocated after it.
+     */
+    void treeArenaTest()
+    {
+        struct Counted {
+            int* destructions;
+            long payload;
+            Counted(int* destructions, const long payload) : destructions(destructions), payload(payload) {}
+            ~Counted() { (*destructions)++; }
+        };
+
+        int destructions = 0;
+        POOL::TreeArena arena;
+
+        // destroyLast right after create frees the memory for the next object
+        auto* first = arena.create<Counted>(&destructions, 1);
+        arena.destroyLast(first);
+        ASSERT_EQUALS(1, destructions);
+        auto* second = arena.create<Counted>(&destructions, 2);
+        ASSERT_TRUE(static_cast<void*>(second) == static_cast<void*>(first));
+
+        // An allocation between create and destroyLast has to survive the next allocations
+        auto* third = arena.create<Counted>(&destructions, 3);
+        auto* untracked = arena.createUntracked<long>(42);
+        std::pmr::vector<long> grown(&arena);
+        grown.push_back(7);
+        arena.destroyLast(third);
+        ASSERT_EQUALS(2, destructions);
+        auto* fourth = arena.create<Counted>(&destructions, 4);
+        arena.createUntracked<long>(99);
+        ASSERT_TRUE(static_cast<void*>(fourth) != static_cast<void*>(third));
+        ASSERT_EQUALS(42, *untracked);
+        ASSERT_EQUALS(7, grown[0]);
+        ASSERT_EQUALS(4, fourth->payload);
+
+        // Adopted heap objects are deleted by destroyLast and reset
+        arena.destroyLast(arena.adopt(new Counted(&destructions, 5)));
+        ASSERT_EQUALS(3, destructions);
+        arena.adopt(new Counted(&destructions, 6));
+
+        // reset destroys second, fourth and the adopted object and rewinds the arena
+        arena.reset();
+        ASSERT_EQUALS(6, destructions);
+        auto* after_reset = arena.create<Counted>(&destructions, 7);
+        ASSERT_TRUE(static_cast<void*>(after_reset) == static_cast<void*>(first));
+        arena.reset();
+        ASSERT_EQUALS(7, destructions);
+
+        std::cout << "- Tree arena test done" << std::endl;
+    }
+
+}
+
+void Mcts::MctsAgent::runTests() {
+    std::cout << "Running tests for MctsAgent" << std::endl;
+
+    uctKernelTest();
+    treeArenaTest();
+
+    std::cout << "Finished tests for MctsAgent" << std::endl;
+}
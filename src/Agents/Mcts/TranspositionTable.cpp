@@ -0,0 +1,20 @@
+#include "../../../include/Agents/Mcts/TranspositionTable.h"
+
+using namespace Mcts;
+
+MctsNode* TranspositionTable::find(const int depth, ABS::Gamestate* state)
+{
+    const Key key = {depth, state};
+    auto& shard = getShard(key);
+    std::lock_guard lock(shard.mutex);
+    const auto it = shard.nodes.find(key);
+    return it == shard.nodes.end()? nullptr : it->second;
+}
+
+MctsNode* TranspositionTable::insert(const int depth, ABS::Gamestate* state, MctsNode* node)
+{
+    const Key key = {depth, state};
+    auto& shard = getShard(key);
+    std::lock_guard lock(shard.mutex);
+    return shard.nodes.try_emplace(key, node).first->second;
+}
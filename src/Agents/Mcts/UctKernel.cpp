@@ -0,0 +1,142 @@
+#include "../../../include/Agents/Mcts/UctKernel.h"
+
+#include <cmath>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+using namespace Mcts;
+
+// Score of a single action. The AVX2 kernel performs exactly the same IEEE operations in the same order.
+static double actionScore(const int* visits, const double* values, const int* virtual_visits, const double* virtual_values, const int num_players, const int player, const int idx, const UctScoreParams& params)
+{
+    const double n = virtual_visits == nullptr ? visits[idx] : visits[idx] + virtual_visits[idx];
+    const double v = virtual_visits == nullptr ? values[idx * num_players + player] : values[idx * num_players + player] + virtual_values[idx];
+    const double q_value = v / (params.max_backup ? 1.0 : n);
+    const double exploration_term = params.puct ? params.numerator / (1.0 + n) : std::sqrt(params.numerator / n);
+    double score;
+    if (params.greedy)
+        score = q_value;
+    else if (params.uniform)
+        score = exploration_term;
+    else
+        score = q_value + params.exploration_factor * exploration_term;
+    return score + params.noise_scale * tiebreakNoise(params.noise_key, idx);
+}
+
+int Mcts::selectBestActionScalar(const int* visits, const double* values, const int* virtual_visits, const double* virtual_values, const int num_players, const int player, const int num_actions, const UctScoreParams& params)
+{
+    double best_value = -std::numeric_limits<double>::infinity();
+    int best_idx = -42;
+    for (int idx = 0; idx < num_actions; idx++) {
+        const double s = actionScore(visits, values, virtual_visits, virtual_values, num_players, player, idx, params);
+        if (s > best_value) {
+            best_value = s;
+            best_idx = idx;
+        }
+    }
+    return best_idx;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// Four actions per step. Every lane keeps its first maximum, the lanes are merged by preferring the smaller index on ties,
+// which selects the same action as the sequential scan.
+__attribute__((target("avx2")))
+int Mcts::selectBestActionAvx2(const int* visits, const double* values, const int* virtual_visits, const double* virtual_values, const int num_players, const int player, const int num_actions, const UctScoreParams& params)
+{
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d numerator = _mm256_set1_pd(params.numerator);
+    const __m256d exploration_factor = _mm256_set1_pd(params.exploration_factor);
+    const __m256d noise_scale = _mm256_set1_pd(params.noise_scale);
+    const __m256d noise_norm = _mm256_set1_pd(0x1p-31);
+    const __m256d all_lanes = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+
+    __m256d best_scores = _mm256_set1_pd(-std::numeric_limits<double>::infinity());
+    __m256d best_idxs = _mm256_set1_pd(-42);
+    __m256d idxs = _mm256_setr_pd(0, 1, 2, 3);
+    __m128i idxs32 = _mm_setr_epi32(0, 1, 2, 3);
+    __m128i value_offsets = _mm_mullo_epi32(idxs32, _mm_set1_epi32(num_players));
+
+    int idx = 0;
+    for (; idx + 4 <= num_actions; idx += 4) {
+        __m128i n32 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(visits + idx));
+        __m256d v = num_players == 1 ? _mm256_loadu_pd(values + idx + player) : _mm256_mask_i32gather_pd(_mm256_setzero_pd(), values + player, value_offsets, all_lanes, 8);
+        if (virtual_visits != nullptr) {
+            n32 = _mm_add_epi32(n32, _mm_loadu_si128(reinterpret_cast<const __m128i*>(virtual_visits + idx)));
+            v = _mm256_add_pd(v, _mm256_loadu_pd(virtual_values + idx));
+        }
+        const __m256d n = _mm256_cvtepi32_pd(n32);
+        const __m256d q_value = params.max_backup ? v : _mm256_div_pd(v, n);
+        const __m256d exploration_term = params.puct ? _mm256_div_pd(numerator, _mm256_add_pd(one, n)) : _mm256_sqrt_pd(_mm256_div_pd(numerator, n));
+        __m256d scores;
+        if (params.greedy)
+            scores = q_value;
+        else if (params.uniform)
+            scores = exploration_term;
+        else
+            scores = _mm256_add_pd(q_value, _mm256_mul_pd(exploration_factor, exploration_term));
+
+        // tiebreakNoise for four indices
+        __m128i key = _mm_add_epi32(_mm_set1_epi32(static_cast<int>(params.noise_key)), _mm_mullo_epi32(idxs32, _mm_set1_epi32(static_cast<int>(0x9e3779b9U))));
+        key = _mm_xor_si128(key, _mm_srli_epi32(key, 16));
+        key = _mm_mullo_epi32(key, _mm_set1_epi32(0x7feb352d));
+        key = _mm_xor_si128(key, _mm_srli_epi32(key, 15));
+        key = _mm_mullo_epi32(key, _mm_set1_epi32(static_cast<int>(0x846ca68bU)));
+        key = _mm_xor_si128(key, _mm_srli_epi32(key, 16));
+        const __m256d noise = _mm256_mul_pd(_mm256_cvtepi32_pd(key), noise_norm);
+        scores = _mm256_add_pd(scores, _mm256_mul_pd(noise_scale, noise));
+
+        const __m256d better = _mm256_cmp_pd(scores, best_scores, _CMP_GT_OQ);
+        best_scores = _mm256_blendv_pd(best_scores, scores, better);
+        best_idxs = _mm256_blendv_pd(best_idxs, idxs, better);
+
+        idxs = _mm256_add_pd(idxs, _mm256_set1_pd(4));
+        idxs32 = _mm_add_epi32(idxs32, _mm_set1_epi32(4));
+        value_offsets = _mm_add_epi32(value_offsets, _mm_set1_epi32(4 * num_players));
+    }
+
+    double lane_scores[4], lane_idxs[4];
+    _mm256_storeu_pd(lane_scores, best_scores);
+    _mm256_storeu_pd(lane_idxs, best_idxs);
+    double best_value = -std::numeric_limits<double>::infinity();
+    int best_idx = -42;
+    for (int lane = 0; lane < 4; lane++) {
+        const int lane_idx = static_cast<int>(lane_idxs[lane]);
+        if (lane_idx != -42 && (lane_scores[lane] > best_value || (lane_scores[lane] == best_value && lane_idx < best_idx))) {
+            best_value = lane_scores[lane];
+            best_idx = lane_idx;
+        }
+    }
+
+    for (; idx < num_actions; idx++) {
+        const double s = actionScore(visits, values, virtual_visits, virtual_values, num_players, player, idx, params);
+        if (s > best_value) {
+            best_value = s;
+            best_idx = idx;
+        }
+    }
+    return best_idx;
+}
+
+bool Mcts::hasAvx2()
+{
+    static const bool has_avx2 = [] {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") != 0;
+    }();
+    return has_avx2;
+}
+
+#endif
+
+int Mcts::selectBestAction(const int* visits, const double* values, const int* virtual_visits, const double* virtual_values, const int num_players, const int player, const int num_actions, const UctScoreParams& params)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    if (hasAvx2())
+        return selectBestActionAvx2(visits, values, virtual_visits, virtual_values, num_players, player, num_actions, params);
+#endif
+    return selectBestActionScalar(visits, values, virtual_visits, virtual_values, num_players, player, num_actions, params);
+}
@@ -50,15 +50,15 @@ size_t OgaAbstractNode::hash() const{
 // OgaAbstractStateNode
 void OgaAbstractStateNode::transfer(OgaStateNode* state_node, OgaAbstractStateNode* from, OgaAbstractStateNode* to, AbsStateSet& abstract_state_nodes){
     if (from != to) {
-        abstract_state_nodes.erase(to);
-        to->add(state_node);
-        abstract_state_nodes.insert(to);
-        if (from != nullptr) {
+        if (from != nullptr) { // Removed first, as the ground node can only store its position in one abstract node
             abstract_state_nodes.erase(from);
             from->remove(state_node);
             if (from->getCount() > 0)
                 abstract_state_nodes.insert(from);
         }
+        abstract_state_nodes.erase(to);
+        to->add(state_node);
+        abstract_state_nodes.insert(to);
         state_node->setAbstractNode(to);
     }
 }
@@ -79,19 +79,9 @@ void OgaAbstractStateNode::add(OgaStateNode* state_node){
 }
 
 void OgaAbstractStateNode::remove(OgaStateNode* state_node){
-    assert (ground_nodes.contains(state_node));
     ground_nodes.erase(state_node);
-    if (state_node == getRepresentant()) {
-        OgaStateNode *representant = nullptr;
-        unsigned min_id = std::numeric_limits<unsigned>::max();
-        for (auto* other_node : ground_nodes) { //Min id for reproducibility
-            if (other_node->getId() < min_id || representant == nullptr) {
-                min_id = other_node->getId();
-                representant = other_node;
-            }
-        }
-        setRepresentant(representant);
-    }
+    if (state_node == getRepresentant())
+        setRepresentant(ground_nodes.minIdNode()); //Min id for reproducibility
     decreaseCount();
 }
 
@@ -129,23 +119,22 @@ double OgaAbstractQStateNode::getVisits() const{
 void OgaAbstractQStateNode::transfer(OgaQStateNode* q_state_node, OgaAbstractQStateNode* from,OgaAbstractQStateNode* to, AbsQSet& abs_q_set,OgaBehaviorFlags& flags){
 
     if (from != to) {
-        abs_q_set.erase(to);
-        to->add(q_state_node, flags);
-        abs_q_set.insert(to);
-        if (from != nullptr) {
+        if (from != nullptr) { // Removed first, as the ground node can only store its position in one abstract node
             abs_q_set.erase(from);
             from->remove(q_state_node, flags);
             if (from->getCount() > 0){
                 abs_q_set.insert(from);
             }
         }
+        abs_q_set.erase(to);
+        to->add(q_state_node, flags);
+        abs_q_set.insert(to);
         q_state_node->setAbstractNode(to);
     }
 
 }
 
 void OgaAbstractQStateNode::add(OgaQStateNode* q_state_node,OgaBehaviorFlags& flags){
-    assert (!ground_nodes.contains(q_state_node));
     ground_nodes.insert(q_state_node);
     if (getCount() == 0)
         setRepresentant(q_state_node);
@@ -153,30 +142,22 @@ void OgaAbstractQStateNode::add(OgaQStateNode* q_state_node,OgaBehaviorFlags& fl
     visits += q_state_node->getVisits();
     values += q_state_node->getValues();
     squared_values += q_state_node->getSquaredValues();
+    virtual_visits += q_state_node->getVirtualVisits();
+    virtual_values += q_state_node->getVirtualValues();
     increaseCount();
 }
 
 void OgaAbstractQStateNode::remove(OgaQStateNode* q_state_node,OgaBehaviorFlags& flags){
-    assert (ground_nodes.contains(q_state_node));
-
-    if (q_state_node == getRepresentant()) {
-        OgaQStateNode *representant = nullptr;
-        unsigned min_id = std::numeric_limits<unsigned>::max();
-        for (auto* other_node : ground_nodes) { //Min id for reproducibility
-            if (q_state_node != other_node && (other_node->getId() < min_id || representant == nullptr)) {
-                min_id = other_node->getId();
-                representant = other_node;
-            }
-        }
-
-        setRepresentant(representant);
-    }
+    ground_nodes.erase(q_state_node);
+    if (q_state_node == getRepresentant())
+        setRepresentant(ground_nodes.minIdNode()); //Min id for reproducibility
 
     visits -= q_state_node->getVisits();
     values -= q_state_node->getValues();
     squared_values -= q_state_node->getSquaredValues();
+    virtual_visits -= q_state_node->getVirtualVisits();
+    virtual_values = virtual_visits == 0? 0 : virtual_values - q_state_node->getVirtualValues();
     decreaseCount();
-    ground_nodes.erase(q_state_node);
 
 }
 
@@ -6,17 +6,35 @@
 
 #include "../../../include/Games/Wrapper/FiniteHorizon.h"
 
+#include <atomic>
 #include <cassert>
 #include <cmath>
 #include <chrono>
 #include <utility>
 #include <cstring>
+#include <fstream>
+#include <mutex>
+#include <ranges>
+#include <shared_mutex>
 
 #include "../../../include/Utils/Distributions.h"
 
 using namespace OGA;
 
+static InAbsPolicy parseInAbsPolicy(const std::string& in_abs_policy){
+    static const std::map<std::string, InAbsPolicy> policies = {
+        {"random", InAbsPolicy::RANDOM}, {"random_greedy", InAbsPolicy::RANDOM_GREEDY}, {"uct", InAbsPolicy::UCT},
+        {"least_outcomes", InAbsPolicy::LEAST_OUTCOMES}, {"first", InAbsPolicy::FIRST}, {"greedy", InAbsPolicy::GREEDY},
+        {"least_visits", InAbsPolicy::LEAST_VISITS}, {"most_visits", InAbsPolicy::MOST_VISITS}
+    };
+    const auto it = policies.find(in_abs_policy);
+    if (it == policies.end())
+        throw std::runtime_error("Unknown in_abs_policy: " + in_abs_policy);
+    return it->second;
+}
+
 OgaAgent::~OgaAgent(){
+    delete previous_tree;
 }
 
 OgaAgent::OgaAgent(const OgaArgs& args) :
@@ -24,15 +42,40 @@ OgaAgent::OgaAgent(const OgaArgs& args) :
     discount(args.discount),
     num_rollouts(args.num_rollouts),
     rollout_length(args.rollout_length),
+    threads(args.threads),
+    shared_tree(args.shared_tree),
     recency_count_limit(args.recency_count_limit),
     budget(args.budget),
     args(args),
-    in_abs_policy(args.in_abs_policy),
+    behavior_flags(args.behavior_flags),
+    in_abs_policy(parseInAbsPolicy(args.in_abs_policy)),
     track_statistics(args.track_statistics),
     Q_map(args.Q_map),
     distribution_agent(args.distribution_agent)
 {
     assert (args.exploration_parameter >= 0);
+    behavior_flags.resolveAlgorithms();
+    if (threads < 1)
+        throw std::runtime_error("[OgaAgent] threads must be at least 1");
+    if (threads > 1 && track_statistics)
+        throw std::runtime_error("[OgaAgent] track_statistics is not supported for threads > 1");
+    if (args.rollout_threads < 1)
+        throw std::runtime_error("[OgaAgent] rollout_threads must be at least 1");
+    if (args.rollout_threads > 1 && threads > 1)
+        throw std::runtime_error("[OgaAgent] rollout_threads > 1 is not supported for threads > 1");
+    if (args.rollout_threads > 1 && num_rollouts > 1)
+        rollout_pool = std::make_unique<PARALLEL::RolloutPool>(args.rollout_threads);
+    rollout_scratches.resize(threads);
+    if (args.reuse_tree && threads > 1)
+        throw std::runtime_error("[OgaAgent] reuse_tree is not supported for threads > 1");
+    if (args.abs_update_interval < 1)
+        throw std::runtime_error("[OgaAgent] abs_update_interval must be at least 1");
+#ifndef OGA_TELEMETRY
+    if (!args.telemetry_file.empty())
+        throw std::runtime_error("[OgaAgent] telemetry_file requires compiling with OGA_TELEMETRY");
+#endif
+    if (!args.telemetry_file.empty() && threads > 1)
+        throw std::runtime_error("[OgaAgent] telemetry_file is not supported for threads > 1");
 }
 
 int OgaAgent::getAction(ABS::Model* model, ABS::Gamestate* state, std::mt19937& rng){
@@ -43,38 +86,294 @@ int OgaAgent::getAction(ABS::Model* model, ABS::Gamestate* state, std::mt19937&
 
     assert (dynamic_cast<FINITEH::Model*>(model) != nullptr && dynamic_cast<FINITEH::Gamestate*>(state) != nullptr);
 
+    if (threads > 1)
+        return shared_tree? getSharedTreeAction(model, state, rng, treePtr) : getRootParallelAction(model, state, rng, treePtr);
+
     const auto start = std::chrono::high_resolution_clock::now();
 
     OgaSearchStats search_stats = {budget, 0, 0,0,0,0,0,0,0,0,0};
-    const auto total_forward_calls_before = model->getForwardCalls();
 
-    auto tree = new OgaTree{state, model, args.behavior_flags,rng, search_stats
-    };
+    OgaTree* tree = args.reuse_tree? reuseTree(model, state, search_stats, rng) : nullptr;
+    if (tree == nullptr)
+        tree = new OgaTree{state, model, behavior_flags,rng, search_stats
+        };
+
+    if (rollout_pool != nullptr)
+        rollout_pool->attach(model);
+    search(tree, model, search_stats, rng, start, nullptr, rollout_scratches[0]);
+    if (rollout_pool != nullptr)
+        rollout_pool->detach();
+
+    const int best_action = selectAction(tree, model, tree->getRoot(), true, search_stats, rng);
+
+    //Abstraction dropping statistics
+    if (track_statistics)
+        tree->updateStatistics(layerwise_statistics, global_statistics, Q_map, rng);
+
+    if (!args.telemetry_file.empty())
+        writeTelemetry(search_stats);
+
+    const int action = distribution_agent == nullptr? best_action : distribution_agent->getAction(model, state, rng);
+
+    if (treePtr != nullptr)
+        *treePtr = tree;
+    else if (args.reuse_tree) {
+        previous_tree = tree;
+        previous_action = action;
+    }
+    else
+        delete tree;
+
+    return action;
+}
+
+/*
+ * Looks up the current state among the sampled successors of the action taken in the previous decision. If it is found, its subtree
+ * is copied into a new tree, otherwise nullptr is returned. The previous tree is released in both cases.
+ */
+OgaTree* OgaAgent::reuseTree(ABS::Model* model, ABS::Gamestate* state, OgaSearchStats& search_stats, std::mt19937& rng) {
+    if (previous_tree == nullptr)
+        return nullptr;
+
+    OgaTree* tree = nullptr;
+    for (const auto* q_node : previous_tree->getRoot()->getChildren()) {
+        if (q_node->getAction() != previous_action)
+            continue;
+        if (const auto* successor = q_node->findChild(state); successor != nullptr) {
+            tree = new OgaTree(*previous_tree, successor, model, search_stats);
+            tree->performUpdateAbstractions(recency_count_limit, search_stats, rng);
+        }
+        break;
+    }
+
+    delete previous_tree;
+    previous_tree = nullptr;
+    return tree;
+}
+
+/*
+ * Appends the telemetry of the last decision to args.telemetry_file. The CSV header is written when the file is empty.
+ */
+void OgaAgent::writeTelemetry(const OgaSearchStats& search_stats) {
+#ifdef OGA_TELEMETRY
+    const bool json = args.telemetry_file.ends_with(".json");
+    std::ofstream file(args.telemetry_file, std::ios::app);
+    if (!file)
+        throw std::runtime_error("[OgaAgent] Could not open telemetry file " + args.telemetry_file);
+    if (!json && file.tellp() == 0)
+        file << OgaTelemetry::csvHeader() << "\n";
+    const auto& telemetry = search_stats.telemetry;
+    file << (json? telemetry.toJson(telemetry_decision, search_stats.completed_iterations) : telemetry.toCsv(telemetry_decision, search_stats.completed_iterations)) << "\n";
+#endif
+    telemetry_decision++;
+}
+
+// Locks mutex only when searching a shared tree
+static std::unique_lock<std::mutex> lockIfShared(std::mutex& mutex, const OgaSearchStats& search_stats){
+    return search_stats.shared_tree_mutex == nullptr? std::unique_lock<std::mutex>() : std::unique_lock(mutex);
+}
+
+// Locks the global statistics of search_stats and the node sets of the tree only when searching a shared tree
+static std::unique_lock<std::mutex> lockTree(const OgaSearchStats& search_stats){
+    return search_stats.shared_tree_mutex == nullptr? std::unique_lock<std::mutex>() : std::unique_lock(*search_stats.shared_tree_mutex);
+}
 
+bool OgaAgent::treeFull(const OgaTree* tree) const {
+    return args.max_tree_nodes > 0 && tree->numNodes() >= args.max_tree_nodes;
+}
+
+/*
+ * Abstraction updates are batched: They happen every abs_update_interval iterations or once abs_update_threshold nodes are staged.
+ */
+bool OgaAgent::abstractionUpdateDue(const OgaTree* tree, const int completed_iterations) const {
+    return completed_iterations % args.abs_update_interval == 0 || (args.abs_update_threshold > 0 && tree->numStagedNodes() >= args.abs_update_threshold);
+}
+
+/*
+ * Runs iterations on the given tree until the budget in search_stats is exhausted. If shared_forward_calls is given, forward calls are
+ * counted over all searches sharing it.
+ */
+void OgaAgent::search(OgaTree* tree, ABS::Model* model, OgaSearchStats& search_stats, std::mt19937& rng, const std::chrono::high_resolution_clock::time_point start,
+                      std::atomic<long>* shared_forward_calls, PARALLEL::RolloutScratch& scratch) {
+
+    const auto total_forward_calls_before = model->getForwardCalls();
+    const auto& [amount, quantity] = search_stats.budget;
+
+    std::vector<OgaQStateNode*> trajectory;
     bool done = false;
     while (!done){
-        OgaStateNode* leaf = treePolicy(tree, model, search_stats, rng);
-        const auto rewards = rollout(leaf, model, rng);
-        backup(tree, leaf, rewards, search_stats);
-        tree->performUpdateAbstractions(recency_count_limit,search_stats, rng);
+        trajectory.clear();
+        OgaStateNode* leaf;
+        std::vector<double> rewards;
+        {
+            OGA_TELEMETRY_PHASE(search_stats, TREE_POLICY);
+            leaf = treePolicy(tree, model, search_stats, rng, trajectory);
+        }
+        {
+            OGA_TELEMETRY_PHASE(search_stats, ROLLOUT);
+            rewards = rollout(leaf, model, rng, scratch);
+        }
+        {
+            OGA_TELEMETRY_PHASE(search_stats, BACKUP);
+            backup(tree, trajectory, rewards, search_stats);
+        }
+        if (abstractionUpdateDue(tree, search_stats.completed_iterations + 1)) {
+            OGA_TELEMETRY_PHASE(search_stats, ABSTRACTION_UPDATE);
+            tree->performUpdateAbstractions(recency_count_limit,search_stats, rng);
+        }
 
         search_stats.completed_iterations++;
-        search_stats.total_forward_calls = model->getForwardCalls() - total_forward_calls_before;
-
-        if(budget.quantity == "iterations"){
-            done = search_stats.completed_iterations >= budget.amount;
-        } else if (budget.quantity == "forward_calls"){
-            done = static_cast<int>(search_stats.total_forward_calls) >= budget.amount;
-        } else if (budget.quantity == "milliseconds"){
-            done = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() >= budget.amount;
+        const unsigned forward_calls = model->getForwardCalls() - total_forward_calls_before;
+        long budget_forward_calls = forward_calls;
+        if (shared_forward_calls != nullptr)
+            budget_forward_calls = shared_forward_calls->fetch_add(forward_calls - search_stats.total_forward_calls) + (forward_calls - search_stats.total_forward_calls);
+        search_stats.total_forward_calls = forward_calls;
+
+        if(quantity == "iterations"){
+            done = search_stats.completed_iterations >= amount;
+        } else if (quantity == "forward_calls"){
+            done = budget_forward_calls >= amount;
+        } else if (quantity == "milliseconds"){
+            done = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() >= amount;
         }
     }
 
-    const int best_action = selectAction(model, tree->getRoot(), true, search_stats, rng);
+    // Apply the last batch, so that the decision is based on up-to-date abstractions
+    if (tree->numStagedNodes() > 0) {
+        OGA_TELEMETRY_PHASE(search_stats, ABSTRACTION_UPDATE);
+        tree->performUpdateAbstractions(recency_count_limit,search_stats, rng);
+    }
+}
 
-    //Abstraction dropping statistics
-    if (track_statistics)
-        tree->updateStatistics(layerwise_statistics, global_statistics, Q_map, rng);
+/*
+ * Root parallelization: Every worker searches its own tree with a random stream forked from rng. The first worker uses the given model,
+ * all others a clone of it.
+ * An iteration budget is split among the workers and a forward call budget is shared by them.
+ */
+int OgaAgent::getRootParallelAction(ABS::Model* model, ABS::Gamestate* state, std::mt19937& rng, OgaTree** treePtr) {
+
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    const auto worker_budgets = PARALLEL::splitBudget(budget, threads);
+    const int num_workers = static_cast<int>(worker_budgets.size());
+    const PARALLEL::ModelClones models(model, num_workers, true);
+    auto rngs = PARALLEL::forkRngs(rng, num_workers);
+    std::vector<OgaSearchStats> worker_stats;
+    for (const auto& worker_budget : worker_budgets)
+        worker_stats.push_back({worker_budget, 0, 0,0,0,0,0,0,0,0,0});
+
+    std::vector<OgaTree*> trees(num_workers, nullptr);
+    std::atomic<long> shared_forward_calls = 0;
+    PARALLEL::runWorkers(num_workers, [&](const int i) {
+        trees[i] = new OgaTree{state, models[i], behavior_flags, rngs[i], worker_stats[i]};
+        search(trees[i], models[i], worker_stats[i], rngs[i], start, &shared_forward_calls, rollout_scratches[i]);
+    });
+
+    const int best_action = selectMergedAction(trees, rng);
+
+    if (treePtr != nullptr)
+        *treePtr = trees[0];
+    else
+        delete trees[0];
+    for (int i = 1; i < num_workers; i++)
+        delete trees[i];
+
+    return distribution_agent == nullptr? best_action : distribution_agent->getAction(model, state, rng);
+}
+
+/*
+ * Tree parallelization: All workers search the same tree. Every ground and abstract q node is guarded by its own mutex, while the
+ * node sets of the tree and the global statistics share the shared_tree_mutex of search_stats, so that workers select, expand and
+ * back up concurrently. While a trajectory is rolled out, its q nodes carry a virtual loss so that the other workers prefer
+ * different paths. Abstraction updates happen in batches (see abstractionUpdateDue) and regroup whole layers, so they wait until
+ * no worker is in its tree policy or backup and block those until done. Rollouts continue meanwhile, as virtual losses move with
+ * the q nodes between abstract nodes.
+ */
+int OgaAgent::getSharedTreeAction(ABS::Model* model, ABS::Gamestate* state, std::mt19937& rng, OgaTree** treePtr) {
+
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    OgaSearchStats search_stats = {budget, 0, 0,0,0,0,0,0,0,0,0};
+    auto tree = new OgaTree{state, model, behavior_flags,rng, search_stats};
+
+    // The tree itself works on the given model, the workers on clones
+    const PARALLEL::ModelClones models(model, threads);
+    auto rngs = PARALLEL::forkRngs(rng, threads);
+
+    std::mutex tree_mutex;
+    search_stats.shared_tree_mutex = &tree_mutex;
+    tree->tabulateLogVisits();
+
+    std::shared_mutex abstraction_barrier; //Held shared by tree policies and backups, exclusively by abstraction updates
+    std::atomic<int> started_iterations = 0;
+    std::atomic<bool> done = false;
+    auto work = [&](ABS::Model* worker_model, std::mt19937& worker_rng, PARALLEL::RolloutScratch& worker_scratch) {
+        std::vector<OgaQStateNode*> trajectory;
+        std::vector<double> virtual_losses;
+        while (!done && (budget.quantity != "iterations" || started_iterations++ < budget.amount)) {
+            const auto forward_calls_before = worker_model->getForwardCalls();
+
+            OgaStateNode* leaf;
+            {
+                const std::shared_lock barrier_lock(abstraction_barrier);
+                trajectory.clear();
+                leaf = treePolicy(tree, worker_model, search_stats, worker_rng, trajectory);
+
+                double var;
+                {
+                    const std::lock_guard tree_lock(tree_mutex);
+                    var = search_stats.global_num_vs == 0? 0 : std::max(0.0,search_stats.total_squared_v / search_stats.global_num_vs - (search_stats.total_v / search_stats.global_num_vs) *  (search_stats.total_v / search_stats.global_num_vs));
+                }
+                virtual_losses.clear();
+                for (auto* q_node : trajectory) {
+                    const std::scoped_lock q_lock(q_node->getMutex(), q_node->getAbstractNode()->getMutex());
+                    const double mean = q_node->getVisits() == 0? 0 : q_node->getValues() / q_node->getVisits();
+                    virtual_losses.push_back(mean - args.virtual_loss * sqrt(var));
+                    q_node->addVirtualLoss(virtual_losses.back());
+                }
+            }
+
+            const auto rewards = rollout(leaf, worker_model, worker_rng, worker_scratch);
+
+            bool update_due;
+            {
+                const std::shared_lock barrier_lock(abstraction_barrier);
+                for (size_t i = 0; i < trajectory.size(); i++) {
+                    const std::scoped_lock q_lock(trajectory[i]->getMutex(), trajectory[i]->getAbstractNode()->getMutex());
+                    trajectory[i]->removeVirtualLoss(virtual_losses[i]);
+                }
+                backup(tree, trajectory, rewards, search_stats);
+
+                const std::lock_guard tree_lock(tree_mutex);
+                search_stats.completed_iterations++;
+                update_due = abstractionUpdateDue(tree, search_stats.completed_iterations);
+                search_stats.total_forward_calls += worker_model->getForwardCalls() - forward_calls_before;
+
+                if(budget.quantity == "iterations"){
+                    done = done || search_stats.completed_iterations >= budget.amount;
+                } else if (budget.quantity == "forward_calls"){
+                    done = done || static_cast<int>(search_stats.total_forward_calls) >= budget.amount;
+                } else if (budget.quantity == "milliseconds"){
+                    done = done || std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() >= budget.amount;
+                }
+            }
+
+            if (update_due) {
+                // Another worker may have updated the abstractions while this one waited for the barrier
+                const std::unique_lock barrier_lock(abstraction_barrier);
+                if (tree->numStagedNodes() > 0)
+                    tree->performUpdateAbstractions(recency_count_limit, search_stats, worker_rng);
+            }
+        }
+    };
+
+    PARALLEL::runWorkers(threads, [&](const int i) { work(models[i], rngs[i], rollout_scratches[i]); });
+    search_stats.shared_tree_mutex = nullptr;
+
+    if (tree->numStagedNodes() > 0)
+        tree->performUpdateAbstractions(recency_count_limit, search_stats, rng);
+
+    const int best_action = selectAction(tree, model, tree->getRoot(), true, search_stats, rng);
 
     if (treePtr != nullptr)
         *treePtr = tree;
@@ -84,46 +383,113 @@ int OgaAgent::getAction(ABS::Model* model, ABS::Gamestate* state, std::mt19937&
     return distribution_agent == nullptr? best_action : distribution_agent->getAction(model, state, rng);
 }
 
-OgaStateNode* OgaAgent::treePolicy(OgaTree* tree,  ABS::Model* model, OgaSearchStats& search_stats,std::mt19937& rng){
+/*
+ * Sums the abstract and ground statistics of each root action over all trees. The action with the highest merged abstract
+ * Q value is chosen, the merged ground Q value decides among actions with the same abstract Q value.
+ */
+int OgaAgent::selectMergedAction(const std::vector<OgaTree*>& trees, std::mt19937& rng) const {
+
+    struct MergedStats {
+        double abs_visits = 0;
+        double abs_values = 0;
+        double visits = 0;
+        double values = 0;
+    };
+    std::map<int, MergedStats> merged_stats;
+    for (const auto* tree : trees) {
+        for (const auto* child_q_node : tree->getRoot()->getChildren()) {
+            auto& stats = merged_stats[child_q_node->getAction()];
+            stats.abs_visits += child_q_node->getAbsVisits();
+            stats.abs_values += child_q_node->getAbsValues();
+            stats.visits += child_q_node->getVisits();
+            stats.values += child_q_node->getValues();
+        }
+    }
 
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    double best_abs_value = -std::numeric_limits<double>::infinity();
+    double best_value = -std::numeric_limits<double>::infinity();
+    int best_action = -0x0EADBEEF;
+    for (const auto& [action, stats] : merged_stats) {
+        const double abs_value = stats.abs_values / stats.abs_visits;
+        const double value = stats.values / stats.visits + TIEBREAKER_NOISE * dist(rng); //trick to efficiently break ties
+        if (abs_value > best_abs_value + TIEBREAKER_NOISE || (abs_value >= best_abs_value - TIEBREAKER_NOISE && value > best_value)) {
+            best_abs_value = abs_value;
+            best_value = value;
+            best_action = action;
+        }
+    }
+    assert (best_action != -0x0EADBEEF);
+    return best_action;
+}
+
+OgaStateNode* OgaAgent::treePolicy(OgaTree* tree,  ABS::Model* model, OgaSearchStats& search_stats,std::mt19937& rng, std::vector<OgaQStateNode*>& trajectory){
+
+    const bool shared = search_stats.shared_tree_mutex != nullptr;
     auto* curr_node = tree->getRoot();
 
     while (!curr_node->isTerminal())
     {
-        if (!curr_node->isFullyExpanded())
+        auto node_lock = lockIfShared(curr_node->getMutex(), search_stats);
+
+        // Once the tree is full, only the root's first action is still expanded, so that the decision has a candidate
+        bool expand = !curr_node->isFullyExpanded();
+        if (expand) {
+            const auto tree_lock = lockTree(search_stats);
+            expand = !treeFull(tree) || (curr_node == tree->getRoot() && !curr_node->isPartiallyExpanded());
+        }
+        if (expand)
         {
             auto* state = curr_node->getStateCopy(model);
 
             const int action = curr_node->popUntriedAction();
+            auto tree_lock = lockTree(search_stats);
             auto [q_node, found_q] = tree->findOrCreateQState(state, curr_node->getDepth(), action, rng, search_stats
             );
             assert(!found_q);
+            if (shared)
+                tree_lock.unlock();
 
             auto [rewards, prob] = model->applyAction(state, action, rng, nullptr);
+            if (shared)
+                tree_lock.lock();
             auto [successor, found] = tree->findOrCreateState(state, curr_node->getDepth() + 1, rng, search_stats
             );
+            if (!found && successor->getDepth() > search_stats.max_depth)
+                search_stats.max_depth = successor->getDepth();
+            if (shared)
+                tree_lock.unlock();
 
-            q_node->addChild(model->copyState(state), prob, successor);
+            // The new q node is only reachable through curr_node, which is still locked
+            q_node->addChild(prob, successor);
             q_node->setRewards(rewards);
             q_node->setParent(curr_node);
 
             delete state;
+            if (shared)
+                node_lock.unlock();
 
             // Trajectory bookkeeping
-            successor->setTrajectoryParent(q_node);
-
-            if (!found){
-                if (successor->getDepth() > search_stats.max_depth)
-                    search_stats.max_depth = successor->getDepth();
+            {
+                const auto successor_lock = lockIfShared(successor->getMutex(), search_stats);
+                successor->addParent(q_node);
+            }
+            trajectory.push_back(q_node);
 
+            if (!found)
                 return successor;
-            }
             curr_node = successor;
             continue;
         }
 
+        // Only happens if the tree is full: A node without tried actions can not be expanded anymore and becomes the leaf
+        if (!curr_node->isPartiallyExpanded())
+            return curr_node;
+
+        if (shared)
+            node_lock.unlock();
         bool new_state;
-        curr_node = selectSuccessorState(tree, curr_node, model, search_stats, rng, &new_state);
+        curr_node = selectSuccessorState(tree, curr_node, model, search_stats, rng, &new_state, trajectory);
         if (new_state)
             return curr_node;
     }
@@ -132,64 +498,113 @@ OgaStateNode* OgaAgent::treePolicy(OgaTree* tree,  ABS::Model* model, OgaSearchS
 }
 
 OgaStateNode* OgaAgent::selectSuccessorState(OgaTree* tree, OgaStateNode* node, ABS::Model* model, OgaSearchStats& search_stats, std::mt19937& rng,
-                                             bool* new_state)
+                                             bool* new_state, std::vector<OgaQStateNode*>& trajectory)
 {
-    const int best_action = selectAction(model, node, false, search_stats, rng);
+    const bool shared = search_stats.shared_tree_mutex != nullptr;
+    auto node_lock = lockIfShared(node->getMutex(), search_stats);
+    const int best_action = selectAction(tree, model, node, false, search_stats, rng);
+    if (shared)
+        node_lock.unlock();
 
     const auto sample_state = node->getStateCopy(model);
+    auto tree_lock = lockTree(search_stats);
     auto [q_node, found_q] = tree->findOrCreateQState(sample_state, node->getDepth(), best_action, rng, search_stats
     );
     assert(found_q);
+    if (shared)
+        tree_lock.unlock();
 
     // Sample successor of state-action-pair
     auto [rewards, prob] = model->applyAction(sample_state, best_action, rng, nullptr);
+    if (shared)
+        tree_lock.lock();
+    if (treeFull(tree) && tree->findState(sample_state, node->getDepth() + 1) == nullptr) {
+        // The tree is full and the outcome is new: The iteration ends in node, which is returned as leaf without adding q_node to the trajectory
+        delete sample_state;
+        *new_state = true;
+        return node;
+    }
     auto [successor, found] = tree->findOrCreateState(sample_state, node->getDepth() + 1, rng, search_stats
     );
     *new_state = !found;
+    if (shared)
+        tree_lock.unlock();
 
-    auto state_cpy = model->copyState(sample_state);
-    bool added_copy = q_node->addChild(state_cpy, prob, successor);
-    if (!added_copy)
-        delete state_cpy;
+    {
+        const auto q_lock = lockIfShared(q_node->getMutex(), search_stats);
+        q_node->addChild(prob, successor);
+    }
 
     // Trajectory bookkeeping
-    successor->setTrajectoryParent(q_node);
+    {
+        const auto successor_lock = lockIfShared(successor->getMutex(), search_stats);
+        successor->addParent(q_node);
+    }
+    trajectory.push_back(q_node);
 
     delete sample_state;
     return successor;
 }
 
-int OgaAgent::selectAction(ABS::Model* model, OgaStateNode* node, const bool greedy, OgaSearchStats& search_stats,std::mt19937& rng)
+int OgaAgent::selectAction(OgaTree* tree, ABS::Model* model, OgaStateNode* node, const bool greedy, OgaSearchStats& search_stats,std::mt19937& rng)
+{
+    switch (in_abs_policy) {
+        case InAbsPolicy::RANDOM: return selectAction<InAbsPolicy::RANDOM>(tree, node, greedy, search_stats, rng);
+        case InAbsPolicy::RANDOM_GREEDY: return selectAction<InAbsPolicy::RANDOM_GREEDY>(tree, node, greedy, search_stats, rng);
+        case InAbsPolicy::UCT: return selectAction<InAbsPolicy::UCT>(tree, node, greedy, search_stats, rng);
+        case InAbsPolicy::LEAST_OUTCOMES: return selectAction<InAbsPolicy::LEAST_OUTCOMES>(tree, node, greedy, search_stats, rng);
+        case InAbsPolicy::FIRST: return selectAction<InAbsPolicy::FIRST>(tree, node, greedy, search_stats, rng);
+        case InAbsPolicy::GREEDY: return selectAction<InAbsPolicy::GREEDY>(tree, node, greedy, search_stats, rng);
+        case InAbsPolicy::LEAST_VISITS: return selectAction<InAbsPolicy::LEAST_VISITS>(tree, node, greedy, search_stats, rng);
+        case InAbsPolicy::MOST_VISITS: return selectAction<InAbsPolicy::MOST_VISITS>(tree, node, greedy, search_stats, rng);
+    }
+    throw std::runtime_error("Unknown in_abs_policy: " + args.in_abs_policy);
+}
+
+template <InAbsPolicy POLICY>
+int OgaAgent::selectAction(OgaTree* tree, OgaStateNode* node, const bool greedy, OgaSearchStats& search_stats, std::mt19937& rng)
 {
     // UCT Formula: w/n + c * sqrt(ln(N)/n)
     assert(node->isPartiallyExpanded());
 
     std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    const auto& children = node->getChildren();
 
-    //Determine N from the UCT formula
+    //Determine N from the UCT formula. ln(N) is the same for all children and therefore only looked up once.
     double parent_node_visits = 0;
-    for (const auto child_q_node : node->getChildren())
-        parent_node_visits += child_q_node->getAbsVisits();
-
+    for (const auto child_q_node : children) {
+        const auto abs_lock = lockIfShared(child_q_node->getAbstractNode()->getMutex(), search_stats);
+        parent_node_visits += child_q_node->getAbsSelectionVisits();
+    }
+    const double log_parent_node_visits = tree->logVisits(parent_node_visits);
 
     //Determine c from the UCT formula
-    const double var = std::max(0.0,search_stats.total_squared_v / search_stats.global_num_vs - (search_stats.total_v / search_stats.global_num_vs) *  (search_stats.total_v / search_stats.global_num_vs));
+    double var;
+    {
+        const auto tree_lock = lockTree(search_stats);
+        var = std::max(0.0,search_stats.total_squared_v / search_stats.global_num_vs - (search_stats.total_v / search_stats.global_num_vs) *  (search_stats.total_v / search_stats.global_num_vs));
+    }
     double dynamic_exp_factor = sqrt(var);
     double exploration_factor = greedy? 0 : args.exploration_parameter * dynamic_exp_factor;
 
     double best_value = -std::numeric_limits<double>::infinity();
     OgaQStateNode* best_qnode = nullptr;
-    for (const auto child_q_node : node->getChildren()){
+    size_t best_idx = 0;
+    for (size_t idx = 0; idx < children.size(); idx++){
+        const auto child_q_node = children[idx];
 
         //Get visits and Q used in uct formula
         double action_visits, Q_value;
-        action_visits = child_q_node->getAbsVisits();
-        Q_value = child_q_node->getAbsValues() / action_visits;
+        {
+            const auto abs_lock = lockIfShared(child_q_node->getAbstractNode()->getMutex(), search_stats);
+            action_visits = child_q_node->getAbsSelectionVisits();
+            Q_value = child_q_node->getAbsSelectionValues() / action_visits;
+        }
 
 
         //Exploration term in uct formula
         double exploration_term = exploration_factor;
-        exploration_term *= sqrt(log(parent_node_visits) / action_visits);
+        exploration_term *= sqrt(log_parent_node_visits / action_visits);
 
         //Get final uct score
         double score = Q_value + exploration_term;
@@ -198,140 +613,154 @@ int OgaAgent::selectAction(ABS::Model* model, OgaStateNode* node, const bool gre
         if (score > best_value){
             best_value = score;
             best_qnode = child_q_node;
+            best_idx = idx;
         }
     }
 
+    assert (best_qnode != nullptr);
+    // The children that share the abstract node of the best child, kept by the node until a child changes its abstract node
+    const auto best_group = node->getChildGroup(best_idx);
+
     if (track_statistics) {
         global_statistics["ucb_calls"]++;
-        int n = 0;
-        for (const auto child_q_node : node->getChildren()) {
-            if (best_qnode->getAbstractNode()->getGroundNodes().contains(child_q_node))
-                n++;
-            if (n >= 2)
-                break;
-        }
-        global_statistics["intra_abs_required"]+= (n >= 2)? 1 : 0;
+        global_statistics["intra_abs_required"]+= (best_group.size() >= 2)? 1 : 0;
     }
 
-    assert (best_qnode != nullptr);
-    if (in_abs_policy == std::string("random") || (!greedy && in_abs_policy == std::string("random_greedy")))
+    if constexpr (POLICY == InAbsPolicy::RANDOM)
+        return best_qnode->getAction();
+    if (POLICY == InAbsPolicy::RANDOM_GREEDY && !greedy)
         return best_qnode->getAction();
-    else if (in_abs_policy == std::string("uct") || in_abs_policy == std::string("least_outcomes") || in_abs_policy == std::string("first") || in_abs_policy == std::string("random_greedy") || in_abs_policy == std::string("greedy") || in_abs_policy == std::string("least_visits") || in_abs_policy == std::string("most_visits")) {
-        double best_value = -std::numeric_limits<double>::infinity();
-        int best_action = -0x0EADBEEF;
-        for (const auto child_q_node : node->getChildren()){
-            if (!best_qnode->getAbstractNode()->getGroundNodes().contains(child_q_node))
-                continue;
-
-            if (in_abs_policy == std::string("first"))
-                return child_q_node->getAction();
-
-            double action_visits = child_q_node->getVisits();
-            double Q_value = child_q_node->getValues() / action_visits;
-            double exploration_term = exploration_factor;
-            exploration_term *= sqrt(log(parent_node_visits) / action_visits);
-
-            double score;
-            if (greedy || in_abs_policy == std::string("greedy"))
-                score = Q_value;
-            else if (in_abs_policy == std::string("uct"))
-                score = Q_value + exploration_term;
-            else if (in_abs_policy == std::string("least_visits"))
-                score = -action_visits;
-            else if (in_abs_policy == std::string("most_visits"))
-                score = action_visits;
-            else if (in_abs_policy == std::string("least_outcomes"))
-                score = -child_q_node->getProbSum();
-            else
-                throw std::runtime_error("Unknown in_abs_policy: " + in_abs_policy);
-
-            score += TIEBREAKER_NOISE * dist(rng); //trick to efficiently break ties
-            if (score > best_value) {
-                best_value = score;
-                best_action = child_q_node->getAction();
-            }
-        }
-        assert (best_action != -0x0EADBEEF);
-        return best_action;
 
+    best_value = -std::numeric_limits<double>::infinity();
+    int best_action = -0x0EADBEEF;
+    for (const auto child_q_node : best_group){
+        if constexpr (POLICY == InAbsPolicy::FIRST)
+            return child_q_node->getAction();
+
+        const auto q_lock = lockIfShared(child_q_node->getMutex(), search_stats);
+        double action_visits = child_q_node->getSelectionVisits();
+        double Q_value = child_q_node->getSelectionValues() / action_visits;
+
+        double score;
+        if (greedy || POLICY == InAbsPolicy::GREEDY || POLICY == InAbsPolicy::RANDOM_GREEDY)
+            score = Q_value;
+        else if constexpr (POLICY == InAbsPolicy::UCT)
+            score = Q_value + exploration_factor * sqrt(log_parent_node_visits / action_visits);
+        else if constexpr (POLICY == InAbsPolicy::LEAST_VISITS)
+            score = -action_visits;
+        else if constexpr (POLICY == InAbsPolicy::MOST_VISITS)
+            score = action_visits;
+        else
+            score = -child_q_node->getProbSum(); // LEAST_OUTCOMES
+
+        score += TIEBREAKER_NOISE * dist(rng); //trick to efficiently break ties
+        if (score > best_value) {
+            best_value = score;
+            best_action = child_q_node->getAction();
+        }
     }
-    else
-        throw std::runtime_error("Unknown in_abs_policy: " + in_abs_policy);
+    assert (best_action != -0x0EADBEEF);
+    return best_action;
 }
 
-std::vector<double> OgaAgent::rollout(const OgaStateNode* leaf, ABS::Model* model, std::mt19937& rng) const
+std::vector<double> OgaAgent::rollout(const OgaStateNode* leaf, ABS::Model* model, std::mt19937& rng, PARALLEL::RolloutScratch& scratch)
 {
-    auto reward_sum = std::vector<double>(model->getNumPlayers(), 0.0);
+    const int num_players = model->getNumPlayers();
+    auto reward_sum = std::vector<double>(num_players, 0.0);
     if (leaf->isTerminal())
         return reward_sum; // No rewards to collect
 
-    for (int i = 0; i < num_rollouts; i++){
-        double total_discount = 1;
-        auto* rollout_state = leaf->getStateCopy(model);
-        int episode_steps = 0;
-        while (!rollout_state->terminal && (rollout_length == -1 || episode_steps < rollout_length)){
-            // Sample action
-            auto available_actions = model->getActions(rollout_state);
-            std::uniform_int_distribution<int> dist(0, static_cast<int>(available_actions.size()) - 1);
-            const int action = available_actions[dist(rng)];
-
-            // Apply action and get rewards
-            auto [rewards, outcome_and_probability] = model->applyAction(rollout_state, action, rng, nullptr);
-            for (int j = 0; j < model->getNumPlayers(); j++)
-                reward_sum[j] += rewards[j] * total_discount;
-            total_discount *= discount;
-
-            episode_steps++;
-        }
-        delete rollout_state;
+    if (rollout_pool == nullptr) {
+        for (int i = 0; i < num_rollouts; i++)
+            playRollout(leaf, model, rng, reward_sum.data(), scratch);
+    } else {
+        rollout_pool->playRollouts(num_rollouts, num_players, rng, [&](ABS::Model* rollout_model, std::mt19937& rollout_rng, double* rewards, PARALLEL::RolloutScratch& worker_scratch) {
+            playRollout(leaf, rollout_model, rollout_rng, rewards, worker_scratch);
+        }, reward_sum.data());
     }
 
-    for (int j = 0; j < model->getNumPlayers(); j++)
+    for (int j = 0; j < num_players; j++)
         reward_sum[j] /= num_rollouts;
 
     return reward_sum;
 }
 
-void OgaAgent::backup(OgaTree* tree, OgaStateNode* leaf, std::vector<double> values, OgaSearchStats& search_stats) const
+// Plays one random rollout from leaf and adds the discounted rewards of each player to reward_sum
+void OgaAgent::playRollout(const OgaStateNode* leaf, ABS::Model* model, std::mt19937& rng, double* reward_sum, PARALLEL::RolloutScratch& scratch) const
+{
+    double total_discount = 1;
+    auto* rollout_state = scratch.copyState(model, leaf->getState());
+    auto& available_actions = scratch.actions;
+    int episode_steps = 0;
+    while (!rollout_state->terminal && (rollout_length == -1 || episode_steps < rollout_length)){
+        // Sample action
+        model->getActions(rollout_state, available_actions);
+        std::uniform_int_distribution<int> dist(0, static_cast<int>(available_actions.size()) - 1);
+        const int action = available_actions[dist(rng)];
+
+        // Apply action and get rewards
+        auto [rewards, outcome_and_probability] = model->applyAction(rollout_state, action, rng, nullptr);
+        for (int j = 0; j < model->getNumPlayers(); j++)
+            reward_sum[j] += rewards[j] * total_discount;
+        total_discount *= discount;
+
+        episode_steps++;
+    }
+    scratch.release(rollout_state);
+}
+
+void OgaAgent::backup(OgaTree* tree, const std::vector<OgaQStateNode*>& trajectory, std::vector<double> values, OgaSearchStats& search_stats) const
 {
-    auto* child_node = leaf;
-    auto* parent_q_node = child_node->popTrajectoryParent();
-    while (parent_q_node != nullptr)
+    for (auto* parent_q_node : std::ranges::reverse_view(trajectory))
     {
         for (size_t i = 0; i < values.size(); i++) {
             auto rewards = parent_q_node->getRewards(i);
             values[i] = values[i] * discount + rewards;
         }
 
-        parent_q_node->addExperience(values[parent_q_node->getState()->turn]);
-        parent_q_node->addRecencyCount();
-        if (parent_q_node->getRecencyCount() >= recency_count_limit)
-            tree->addUpdateQStateNodeAbstraction(parent_q_node);
+        // A shared tree is updated one node at a time, so the statistics of the q node are read while it is locked
+        const int player = parent_q_node->getState()->turn;
+        bool stage_q_node;
+        unsigned q_visits;
+        double q_values;
+        {
+            const auto q_lock = lockIfShared(parent_q_node->getMutex(), search_stats);
+            const auto abs_lock = lockIfShared(parent_q_node->getAbstractNode()->getMutex(), search_stats);
+            parent_q_node->addExperience(values[player]);
+            parent_q_node->addRecencyCount();
+            stage_q_node = parent_q_node->getRecencyCount() >= recency_count_limit;
+            q_visits = parent_q_node->getVisits();
+            q_values = parent_q_node->getValues();
+        }
 
-        child_node = parent_q_node->getParent();
-        child_node->addVisit();
+        auto* child_node = parent_q_node->getParent();
+        bool stage_child_node = false;
+        {
+            const auto node_lock = lockIfShared(child_node->getMutex(), search_stats);
+            child_node->addVisit();
+            if (behavior_flags.resolved_state_abs_alg == StateAbsAlg::RANDOM) {
+                child_node->addRecencyCount(); // Critical for OGA to not group stuff with terminal nodes is that the trajectory's final node's recency counter is not updated but only its parents
+                stage_child_node = child_node->getRecencyCount() >= recency_count_limit;
+            }
+        }
 
-        if (args.behavior_flags.state_abs_alg == "random") {
-            child_node->addRecencyCount(); // Critical for OGA to not group stuff with terminal nodes is that the trajectory's final node's recency counter is not updated but only its parents
-            if (child_node->getRecencyCount() >= recency_count_limit)
-                tree->addUpdateStateNodeAbstraction(child_node);
-        } else if (args.behavior_flags.state_abs_alg != "asap")
-            throw std::runtime_error("[OgaAgent:backup] Unknown state abs alg: " + args.behavior_flags.state_abs_alg);
+        const auto tree_lock = lockTree(search_stats);
+        if (stage_q_node)
+            tree->addUpdateQStateNodeAbstraction(parent_q_node);
+        if (stage_child_node)
+            tree->addUpdateStateNodeAbstraction(child_node);
 
         //Dynamic exploration factor bookkeeping
-        if (parent_q_node->getVisits() == 1)
+        if (q_visits == 1)
             search_stats.global_num_vs++;
-        if(parent_q_node->getVisits() > 1) { //only remove value if it was present before
-            int player = parent_q_node->getState()->turn;
-            double old_q = (parent_q_node->getValues() - values[player]) / ((double) parent_q_node->getVisits()-1);
+        if(q_visits > 1) { //only remove value if it was present before
+            double old_q = (q_values - values[player]) / ((double) q_visits-1);
             search_stats.total_v -= old_q;
             search_stats.total_squared_v -= old_q * old_q;
         }
-        double q = parent_q_node->getValues() / (double) parent_q_node->getVisits();
+        double q = q_values / (double) q_visits;
         search_stats.total_v += q;
         search_stats.total_squared_v+= q*q;
-
-        parent_q_node = child_node->popTrajectoryParent();
     }
 }
 
@@ -14,6 +14,53 @@
 
 using namespace OGA;
 
+// Lookup keys
+
+size_t StateNodeKey::hash() const{
+    return state->hash() ^ std::hash<unsigned>{}(depth);
+}
+
+bool StateNodeKey::operator==(const OgaStateNode& node) const{
+    return *state == *node.getState() && depth == node.getDepth();
+}
+
+size_t QStateNodeKey::hash() const{
+    return state->hash() ^ std::hash<unsigned>{}(depth) ^ std::hash<int>{}(action);
+}
+
+bool QStateNodeKey::operator==(const OgaQStateNode& node) const{
+    return *state == *node.getState() && depth == node.getDepth() && action == node.getAction();
+}
+
+// SuccessorList
+
+OgaStateNode* SuccessorList::find(ABS::Gamestate* state, const unsigned depth) const{
+    if (successors.size() <= INDEX_THRESHOLD) {
+        for (const auto& [probability, successor] : successors) {
+            if (*successor->getState() == *state)
+                return successor;
+        }
+        return nullptr;
+    }
+    const auto it = index.find(StateNodeKey{state, depth});
+    return it == index.end()? nullptr : *it;
+}
+
+bool SuccessorList::insert(const double probability, OgaStateNode* successor){
+    if (find(successor->getState(), successor->getDepth()) != nullptr)
+        return false;
+    successors.emplace_back(probability, successor);
+    if (successors.size() > INDEX_THRESHOLD + 1)
+        index.insert(successor);
+    else if (successors.size() == INDEX_THRESHOLD + 1) {
+        for (const auto& entry : successors)
+            index.insert(entry.second);
+    }
+    return true;
+}
+
+// OgaStateNode
+
 OgaStateNode::OgaStateNode(ABS::Gamestate* state, const unsigned depth, OgaSearchStats& search_stats)
 : id(search_stats.max_state_id++), state(state), depth(depth)
 {}
@@ -46,6 +93,13 @@ unsigned OgaStateNode::getVisits() const{
     return visits;
 }
 
+void OgaStateNode::copyStatistics(const OgaStateNode& other){
+    visits = other.visits;
+    tried_actions = other.tried_actions;
+    untried_actions = other.untried_actions;
+    recency_count = other.recency_count;
+}
+
 void OgaStateNode::initUntriedActions(ABS::Model* model, const std::vector<int>& actions, std::mt19937& rng){
     untried_actions = actions;
     std::ranges::shuffle(untried_actions.begin(), untried_actions.end(), rng);
@@ -77,12 +131,47 @@ unsigned OgaStateNode::numUntriedActions() const{
 
 void OgaStateNode::addChild(OgaQStateNode* child){
     children.push_back(child);
+    child_groups_valid = false;
 }
 
 const std::vector<OgaQStateNode*>& OgaStateNode::getChildren() const{
     return children;
 }
 
+std::span<OgaQStateNode* const> OgaStateNode::getChildGroup(const size_t child_idx){
+    if (!child_groups_valid) {
+        // Groups in the order of their first child. A node has few children, so the group of a child is found by a linear scan.
+        std::vector<const OgaAbstractQStateNode*> group_nodes;
+        std::vector<unsigned> group_ends; //Sizes of the groups at first, then their ends in grouped_children
+        std::vector<unsigned> group_of(children.size());
+        for (size_t i = 0; i < children.size(); i++) {
+            const size_t group = std::ranges::find(group_nodes, children[i]->getAbstractNode()) - group_nodes.begin();
+            if (group == group_nodes.size()) {
+                group_nodes.push_back(children[i]->getAbstractNode());
+                group_ends.push_back(0);
+            }
+            group_of[i] = group;
+            group_ends[group]++;
+        }
+        for (size_t group = 1; group < group_ends.size(); group++)
+            group_ends[group] += group_ends[group - 1];
+
+        std::vector<unsigned> next_position(group_ends.size(), 0);
+        for (size_t group = 1; group < group_ends.size(); group++)
+            next_position[group] = group_ends[group - 1];
+        grouped_children.resize(children.size());
+        child_groups.resize(children.size());
+        for (size_t i = 0; i < children.size(); i++) {
+            const unsigned group = group_of[i];
+            child_groups[i] = {group == 0? 0 : group_ends[group - 1], group_ends[group]};
+            grouped_children[next_position[group]++] = children[i];
+        }
+        child_groups_valid = true;
+    }
+    const auto [begin, end] = child_groups[child_idx];
+    return std::span<OgaQStateNode* const>(grouped_children.data() + begin, end - begin);
+}
+
 void OgaStateNode::setAbstractNode(OgaAbstractStateNode* abstract_node){
     this->abstract_node = abstract_node;
 }
@@ -95,25 +184,17 @@ const Set<OgaQStateNode>& OgaStateNode::getParents() const{
     return parents;
 }
 
-void OgaStateNode::setTrajectoryParent(OgaQStateNode* parent){
-    assert(trajectory_parent == nullptr);
-    trajectory_parent = parent;
+void OgaStateNode::addParent(OgaQStateNode* parent){
     parents.insert(parent);
 }
 
-OgaQStateNode* OgaStateNode::popTrajectoryParent(){
-    auto* parent = trajectory_parent;
-    trajectory_parent = nullptr;
-    return parent;
-}
-
 
 bool OgaStateNode::operator==(const OgaStateNode& other) const{
     return *state == *other.state && depth == other.depth;
 }
 
 size_t OgaStateNode::hash() const{
-    return state->hash() ^ std::hash<unsigned>{}(depth);
+    return StateNodeKey{state, depth}.hash();
 }
 
 // OgaQStateNode
@@ -124,8 +205,6 @@ OgaQStateNode::OgaQStateNode(ABS::Gamestate* state, const unsigned depth, const
 
 OgaQStateNode::~OgaQStateNode(){
     delete state;
-    for (const auto& state : children | std::views::keys)
-        delete state;
 }
 
 ABS::Gamestate *OgaQStateNode::getState() const{
@@ -160,6 +239,14 @@ double OgaQStateNode::getAbsValues() const{
     return abstract_node->getValues();
 }
 
+double OgaQStateNode::getAbsSelectionVisits() const{
+    return abstract_node->getVisits() + abstract_node->getVirtualVisits();
+}
+
+double OgaQStateNode::getAbsSelectionValues() const{
+    return abstract_node->getValues() + abstract_node->getVirtualValues();
+}
+
 void OgaQStateNode::addExperience(double values){
     getAbstractNode()->addExperience(values);
     this->values += values;
@@ -167,21 +254,44 @@ void OgaQStateNode::addExperience(double values){
     visits++;
 }
 
-bool OgaQStateNode::addChild(ABS::Gamestate* state, const double probability, OgaStateNode* child){
-    if (!children.contains(state)) {
-        children[state] = {probability, child};
-        prob_sum += probability;
-        return true;
-    }else
+void OgaQStateNode::copyStatistics(const OgaQStateNode& other){
+    visits = other.visits;
+    values = other.values;
+    squared_values = other.squared_values;
+    rewards = other.rewards;
+    recency_count = other.recency_count;
+}
+
+void OgaQStateNode::addVirtualLoss(const double value){
+    getAbstractNode()->addVirtualLoss(value);
+    virtual_values += value;
+    virtual_visits++;
+}
+
+void OgaQStateNode::removeVirtualLoss(const double value){
+    getAbstractNode()->removeVirtualLoss(value);
+    virtual_values = --virtual_visits == 0? 0 : virtual_values - value; //No rounding residue once nothing is in flight
+}
+
+bool OgaQStateNode::addChild(const double probability, OgaStateNode* child){
+    if (!children.insert(probability, child))
         return false;
+    prob_sum += probability;
+    return true;
 }
 
-const Map<ABS::Gamestate, std::pair<double, OgaStateNode*>>* OgaQStateNode::getChildren() const{
-    return &children;
+OgaStateNode* OgaQStateNode::findChild(ABS::Gamestate* state) const{
+    return children.find(state, depth + 1);
+}
+
+const SuccessorList& OgaQStateNode::getChildren() const{
+    return children;
 }
 
 void OgaQStateNode::setAbstractNode(OgaAbstractQStateNode* abstract_node){
     this->abstract_node = abstract_node;
+    if (parent != nullptr)
+        parent->invalidateChildGroups();
 }
 
 OgaAbstractQStateNode* OgaQStateNode::getAbstractNode() const{
@@ -223,5 +333,5 @@ bool OgaQStateNode::operator==(const OgaQStateNode& other) const{
 }
 
 size_t OgaQStateNode::hash() const{
-    return state->hash() ^ std::hash<unsigned>{}(depth) ^ std::hash<int>{}(action);
+    return QStateNodeKey{state, depth, action}.hash();
 }
\ No newline at end of file
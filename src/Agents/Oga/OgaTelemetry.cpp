@@ -0,0 +1,61 @@
+#include "../../../include/Agents/Oga/OgaTelemetry.h"
+
+#include <chrono>
+#include <sstream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+using namespace OGA;
+
+unsigned long long OgaTelemetry::cycles(){
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+void OgaTelemetry::addStaged(std::vector<unsigned long>& staged, const unsigned depth, const size_t num){
+    if (num == 0)
+        return;
+    if (staged.size() <= depth)
+        staged.resize(depth + 1, 0);
+    staged[depth] += num;
+}
+
+static std::string joinPerDepth(const std::vector<unsigned long>& values, const std::string& separator){
+    std::ostringstream out;
+    for (size_t i = 0; i < values.size(); i++)
+        out << (i > 0 ? separator : "") << values[i];
+    return out.str();
+}
+
+std::string OgaTelemetry::csvHeader(){
+    return "decision;iterations;tree_policy_cycles;rollout_cycles;backup_cycles;abstraction_update_cycles;approx_equal_calls;dist_calls;"
+           "q_transfers;state_transfers;staged_q_states;staged_states";
+}
+
+// Same layout as the playGames CSV output: fields separated by ';', per depth values by ' '
+std::string OgaTelemetry::toCsv(const int decision, const int iterations) const{
+    std::ostringstream out;
+    out << decision << ";" << iterations;
+    for (const auto cycles : phase_cycles)
+        out << ";" << cycles;
+    out << ";" << approx_equal_calls << ";" << dist_calls << ";" << q_transfers << ";" << state_transfers
+        << ";" << joinPerDepth(staged_q_states, " ") << ";" << joinPerDepth(staged_states, " ");
+    return out.str();
+}
+
+std::string OgaTelemetry::toJson(const int decision, const int iterations) const{
+    std::ostringstream out;
+    out << "{\"decision\":" << decision << ",\"iterations\":" << iterations
+        << ",\"cycles\":{\"tree_policy\":" << phase_cycles[TREE_POLICY] << ",\"rollout\":" << phase_cycles[ROLLOUT]
+        << ",\"backup\":" << phase_cycles[BACKUP] << ",\"abstraction_update\":" << phase_cycles[ABSTRACTION_UPDATE] << "}"
+        << ",\"approx_equal_calls\":" << approx_equal_calls << ",\"dist_calls\":" << dist_calls
+        << ",\"q_transfers\":" << q_transfers << ",\"state_transfers\":" << state_transfers
+        << ",\"staged_q_states\":[" << joinPerDepth(staged_q_states, ",") << "]"
+        << ",\"staged_states\":[" << joinPerDepth(staged_states, ",") << "]}";
+    return out.str();
+}
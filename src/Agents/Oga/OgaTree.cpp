@@ -8,9 +8,11 @@
 #include "../../../include/Utils/Distributions.h"
 
 #include <cassert>
+#include <cmath>
 #include <fstream>
 #include <set>
 #include <algorithm>
+#include <bit>
 
 #include "../../../include/Agents/Oga/OgaAgent.h"
 #include "../../../include/Utils/Argparse.h"
@@ -32,96 +34,131 @@ OgaTree::OgaTree(
     this->root = root;
 }
 
-OgaTree::~OgaTree(){
-
-    for (const auto* state_node : d_states) {
-        delete state_node->getLastFilteredNextDistr();
-        delete state_node->getLastNextDistr();
-        delete state_node;
-    }
-    for (const auto* q_state_node : q_states)
-        delete q_state_node;
-
-    for (const auto& next_distribution_map : next_distribution_map){
-        for (const auto* next_distribution : next_distribution_map | std::views::values)
-            delete next_distribution;
-    }
+/*
+ * The ground nodes below new_root are copied layer by layer (ordered by their old ids, so that new ids keep their relative order)
+ * together with their statistics. Each copy starts in its initial abstraction and counts as not yet updated, so that the random
+ * abstraction algorithms can regroup it. All copies that were abstracted in the previous tree are staged for an update, so that the
+ * next call of performUpdateAbstractions rebuilds the abstractions of all depths.
+ */
+OgaTree::OgaTree(const OgaTree& previous_tree, const OgaStateNode* new_root, ABS::Model* model, OgaSearchStats& search_stats) :
+    behavior_flags(previous_tree.behavior_flags), model(model)
+{
+    const unsigned offset = new_root->getDepth();
+    std::unordered_map<const OgaStateNode*, OgaStateNode*> state_copies;
+    std::vector<std::pair<const OgaQStateNode*, OgaQStateNode*>> q_state_copies;
+    std::unordered_set<const OgaStateNode*> discovered = {new_root};
+
+    std::vector<const OgaStateNode*> layer = {new_root};
+    while (!layer.empty()) {
+        std::ranges::sort(layer, [](const OgaStateNode* lhs, const OgaStateNode* rhs) { return lhs->getId() < rhs->getId(); });
+        for (const auto* state_node : layer) {
+            auto* copy = state_pool.create(model->copyState(state_node->getState()), state_node->getDepth() - offset, search_stats);
+            copy->copyStatistics(*state_node);
+            initStateAbstraction(copy, search_stats);
+            d_states.insert(copy);
+            state_copies[state_node] = copy;
+            search_stats.max_depth = std::max(search_stats.max_depth, copy->getDepth());
+        }
 
-    for (const auto& abstract_state_node_map : abstract_state_node_map){
-        for (const auto* next_abstract_q_states : abstract_state_node_map | std::views::keys)
-            delete next_abstract_q_states;
-    }
+        std::vector<const OgaStateNode*> next_layer;
+        for (const auto* state_node : layer) {
+            for (const auto* q_state_node : state_node->getChildren()) {
+                auto* copy = q_state_pool.create(model->copyState(q_state_node->getState()), q_state_node->getDepth() - offset, q_state_node->getAction(), search_stats);
+                copy->copyStatistics(*q_state_node);
+                initQStateAbstraction(copy, search_stats);
+                copy->setParent(state_copies.at(state_node));
+                state_copies.at(state_node)->addChild(copy);
+                q_states.insert(copy);
+                q_state_copies.emplace_back(q_state_node, copy);
+
+                for (const auto& [probability, successor] : q_state_node->getChildren()) {
+                    if (discovered.insert(successor).second)
+                        next_layer.push_back(successor);
+                }
 
-    for (const auto &val: abstract_state_nodes | std::views::values) {
-        for (const auto* abstract_node : val){
-            assert (abstract_node->getCount() > 0);
-            delete abstract_node;
+                // Dynamic exploration factor bookkeeping
+                if (copy->getVisits() > 0) {
+                    const double q = copy->getValues() / copy->getVisits();
+                    search_stats.global_num_vs++;
+                    search_stats.total_v += q;
+                    search_stats.total_squared_v += q * q;
+                }
+            }
         }
+        layer = std::move(next_layer);
     }
 
-    for (auto corpse : abstract_q_corpses)
-        delete corpse;
-
-    for (auto corpse : abstract_state_corpses)
-        delete corpse;
-
-    for (const auto &val: abstract_q_state_nodes | std::views::values){
-        for (const auto* abstract_node : val){
-            assert (abstract_node->getCount() > 0);
-            delete abstract_node;
+    // Link the copied q states to their successors, parents outside the subtree are dropped
+    for (const auto& [q_state_node, copy] : q_state_copies) {
+        for (const auto& [probability, successor_node] : q_state_node->getChildren()) {
+            auto* successor = state_copies.at(successor_node);
+            copy->addChild(probability, successor);
+            successor->addParent(copy);
         }
+        if (q_state_node->hasReceivedAbsUpdate())
+            _stageForUpdate(copy);
+    }
+    for (const auto& [state_node, copy] : state_copies) {
+        if (state_node->hasReceivedAbsUpdate())
+            _stageForUpdate(copy);
     }
+
+    root = state_copies.at(new_root);
 }
 
+OgaTree::~OgaTree() = default; // All nodes and distributions are owned and freed by the tree's pools
+
 OgaStateNode* OgaTree::getRoot() const
 {
     return root;
 }
 
-std::pair<OgaStateNode*, bool> OgaTree::findOrCreateState(ABS::Gamestate* state, const unsigned depth, std::mt19937& rng, OgaSearchStats& search_stats
-)
+void OgaTree::growLayers(const unsigned depth)
 {
-    auto* state_node = new OgaStateNode(model->copyState(state), depth, search_stats
-        );
+    if (layers.size() <= depth)
+        layers.resize(depth + 1);
+}
 
-    if (const auto it = d_states.find(state_node); it != d_states.end()){
-        // State already exists: Delete the new state node and return the existing one
-        delete state_node;
-        return {*it, true};
+/*
+ * Returns log(visits). Visit counts are integral, so the logarithms of small counts are tabulated once and looked up afterwards.
+ */
+double OgaTree::logVisits(const double visits)
+{
+    const auto n = static_cast<size_t>(visits);
+    if (n >= LOG_TABLE_SIZE || static_cast<double>(n) != visits)
+        return std::log(visits);
+    if (n >= log_table.size()) {
+        const size_t old_size = log_table.size();
+        log_table.resize(std::min(LOG_TABLE_SIZE, std::max(2 * old_size, n + 1)));
+        for (size_t i = old_size; i < log_table.size(); i++)
+            log_table[i] = std::log(static_cast<double>(i));
     }
+    return log_table[n];
+}
 
-    // Initialize state abstraction
-    OgaAbstractStateNode* abstract_state_node;
-    if (state->terminal && behavior_flags.group_terminal_states){
-        // Use one terminal abstract state node per depth
-        // Resize terminal abstract state nodes if necessary and create terminal abstract state node
-        if (terminal_abstract_state_nodes.size() <= depth)
-            terminal_abstract_state_nodes.resize(depth + 1);
-        if (terminal_abstract_state_nodes[depth] == nullptr){
-            terminal_abstract_state_nodes[depth] = new OgaAbstractStateNode(depth, search_stats);
-            abstract_state_nodes[static_cast<int>(depth)].insert(terminal_abstract_state_nodes[depth]);
-        }
+void OgaTree::tabulateLogVisits()
+{
+    const size_t old_size = log_table.size();
+    log_table.resize(LOG_TABLE_SIZE);
+    for (size_t i = old_size; i < log_table.size(); i++)
+        log_table[i] = std::log(static_cast<double>(i));
+}
 
-        abstract_state_node = terminal_abstract_state_nodes[depth];
-    }
-    else if (behavior_flags.group_partially_expanded_states)
-    {
-        if (unexplored_abstract_state_nodes.size() <= depth)
-            unexplored_abstract_state_nodes.resize(depth + 1);
-        if (unexplored_abstract_state_nodes[depth] == nullptr){
-            unexplored_abstract_state_nodes[depth] = new OgaAbstractStateNode(depth, search_stats);
-            abstract_state_nodes[static_cast<int>(depth)].insert(unexplored_abstract_state_nodes[depth]);
-        }
+OgaStateNode* OgaTree::findState(ABS::Gamestate* state, const unsigned depth) const
+{
+    const auto it = d_states.find(StateNodeKey{state, depth});
+    return it == d_states.end()? nullptr : *it;
+}
 
-        abstract_state_node = unexplored_abstract_state_nodes[depth];
-    }
-    else{
-        abstract_state_node = new OgaAbstractStateNode(depth, search_stats);
-        abstract_state_nodes[static_cast<int>(depth)].insert(abstract_state_node);
-    }
+std::pair<OgaStateNode*, bool> OgaTree::findOrCreateState(ABS::Gamestate* state, const unsigned depth, std::mt19937& rng, OgaSearchStats& search_stats
+)
+{
+    // Probe without copying the state, only a miss creates a new node
+    if (const auto it = d_states.find(StateNodeKey{state, depth}); it != d_states.end())
+        return {*it, true};
 
-    // Init node and insert into tree
-    OgaAbstractStateNode::transfer(state_node, nullptr, abstract_state_node, abstract_state_nodes[static_cast<int>(depth)]);
+    auto* state_node = state_pool.create(model->copyState(state), depth, search_stats);
+    initStateAbstraction(state_node, search_stats);
     state_node->initUntriedActions(model, state->terminal ? std::vector<int>{} : model->getActions(state), rng);
     d_states.insert(state_node);
 
@@ -131,17 +168,12 @@ std::pair<OgaStateNode*, bool> OgaTree::findOrCreateState(ABS::Gamestate* state,
 std::pair<OgaQStateNode*, bool> OgaTree::findOrCreateQState(ABS::Gamestate* state, const unsigned depth,const int action, std::mt19937& rng, OgaSearchStats& search_stats
 )
 {
-    auto* q_state_node = new OgaQStateNode(model->copyState(state), depth, action, search_stats);
-
-    if (const auto it = q_states.find(q_state_node); it != q_states.end()){
-        // Q-state already exists: Delete the new q-state node and return the existing one
-        delete q_state_node;
+    // Probe without copying the state, only a miss creates a new node
+    if (const auto it = q_states.find(QStateNodeKey{state, depth, action}); it != q_states.end())
         return {*it, true};
-    }
 
-    // Initialize q-state abstraction
-    auto* abstract_q_state_node = new OgaAbstractQStateNode(q_state_node->getDepth(), search_stats);
-    OgaAbstractQStateNode::transfer(q_state_node, nullptr, abstract_q_state_node, abstract_q_state_nodes[static_cast<int>(depth)],behavior_flags);
+    auto* q_state_node = q_state_pool.create(model->copyState(state), depth, action, search_stats);
+    initQStateAbstraction(q_state_node, search_stats);
 
     // Init q state node and insert into tree
     auto [parent, found] = findOrCreateState(state, depth, rng, search_stats
@@ -153,6 +185,44 @@ std::pair<OgaQStateNode*, bool> OgaTree::findOrCreateQState(ABS::Gamestate* stat
     return {q_state_node, false};
 }
 
+void OgaTree::initStateAbstraction(OgaStateNode* state_node, OgaSearchStats& search_stats)
+{
+    const unsigned depth = state_node->getDepth();
+    growLayers(depth);
+    OgaAbstractStateNode* abstract_state_node;
+    if (state_node->isTerminal() && behavior_flags.group_terminal_states){
+        // Use one terminal abstract state node per depth
+        if (layers[depth].terminal_abstract_state_node == nullptr){
+            layers[depth].terminal_abstract_state_node = abstract_state_pool.create(depth, search_stats);
+            layers[depth].abstract_state_nodes.insert(layers[depth].terminal_abstract_state_node);
+        }
+
+        abstract_state_node = layers[depth].terminal_abstract_state_node;
+    }
+    else if (behavior_flags.group_partially_expanded_states)
+    {
+        if (layers[depth].unexplored_abstract_state_node == nullptr){
+            layers[depth].unexplored_abstract_state_node = abstract_state_pool.create(depth, search_stats);
+            layers[depth].abstract_state_nodes.insert(layers[depth].unexplored_abstract_state_node);
+        }
+
+        abstract_state_node = layers[depth].unexplored_abstract_state_node;
+    }
+    else{
+        abstract_state_node = abstract_state_pool.create(depth, search_stats);
+        layers[depth].abstract_state_nodes.insert(abstract_state_node);
+    }
+
+    OgaAbstractStateNode::transfer(state_node, nullptr, abstract_state_node, layers[depth].abstract_state_nodes);
+}
+
+void OgaTree::initQStateAbstraction(OgaQStateNode* q_state_node, OgaSearchStats& search_stats)
+{
+    growLayers(q_state_node->getDepth());
+    auto* abstract_q_state_node = abstract_q_state_pool.create(q_state_node->getDepth(), search_stats);
+    OgaAbstractQStateNode::transfer(q_state_node, nullptr, abstract_q_state_node, layers[q_state_node->getDepth()].abstract_q_state_nodes,behavior_flags);
+}
+
 void OgaTree::insert(OgaStateNode* state_node){
     d_states.insert(state_node);
 }
@@ -163,45 +233,60 @@ void OgaTree::insert(OgaQStateNode* state_node){
 
 void OgaTree::_stageForUpdate(OgaStateNode* state_node){
     auto depth = state_node->getDepth();
-    if (to_update_states.size() <= depth){
-        to_update_states.resize(depth + 1);
-        abstract_state_node_map.resize(depth + 1);
+    assert (depth < layers.size());
+    if (layers[depth].to_update_states.insert(state_node).second) {
+        num_staged++;
+        markDirty(depth);
     }
-    to_update_states[depth].insert(state_node);
 }
 void OgaTree::_stageForUpdate(OgaQStateNode* q_state_node){
     auto depth = q_state_node->getDepth();
-    if (to_update_q_states.size() <= depth){
-        to_update_q_states.resize(depth + 1);
-        next_distribution_map.resize(depth + 1);
+    assert (depth < layers.size());
+    if (layers[depth].to_update_q_states.insert(q_state_node).second) {
+        num_staged++;
+        markDirty(depth);
     }
-    to_update_q_states[depth].insert(q_state_node);
+}
+
+void OgaTree::markDirty(const unsigned depth){
+    if (dirty_depths.size() <= depth / 64)
+        dirty_depths.resize(depth / 64 + 1, 0);
+    dirty_depths[depth / 64] |= uint64_t{1} << (depth % 64);
+}
+
+int OgaTree::deepestDirtyDepth(const int max_depth) const{
+    if (max_depth < 0)
+        return -1;
+    for (int word = std::min(max_depth / 64, static_cast<int>(dirty_depths.size()) - 1); word >= 0; word--) {
+        uint64_t bits = dirty_depths[word];
+        if (word == max_depth / 64 && max_depth % 64 != 63)
+            bits &= (uint64_t{1} << (max_depth % 64 + 1)) - 1;
+        if (bits != 0)
+            return word * 64 + std::bit_width(bits) - 1;
+    }
+    return -1;
 }
 
 void OgaTree::updateQAbstractions(unsigned K, int depth, std::mt19937& rng, OgaSearchStats& search_stats) {
 
-    //Sort by id for reproducibility (for eps > 0 case this might make a difference)
-    std::vector<OgaQStateNode*> sorted_to_update_nodes = std::vector(to_update_q_states[depth].begin(), to_update_q_states[depth].end());
-    std::sort(sorted_to_update_nodes.begin(), sorted_to_update_nodes.end(),
-              [](const OgaQStateNode* lhs, const OgaQStateNode* rhs) {
-                  return lhs->getId() < rhs->getId();  // Sort by ID
-              });
+    //Visited in id order for reproducibility (for eps > 0 case this might make a difference). Updates only stage nodes of other sets.
+    OGA_TELEMETRY_STAGED(search_stats, staged_q_states, depth, layers[depth].to_update_q_states.size());
 
     //Update the abstraction
-    for (auto* q_state_node : sorted_to_update_nodes){
+    for (auto* q_state_node : layers[depth].to_update_q_states){
 
         // Calculate Successor distribution and update Certainty
         double threshold = 0;
         if (behavior_flags.alpha > 0) {
-            for (const auto& probability_successor : *q_state_node->getChildren() | std::views::values) {
+            for (const auto& probability_successor : q_state_node->getChildren()) {
                 auto& [probability, successor] = probability_successor;
                 threshold = probability*behavior_flags.alpha > threshold ? probability*behavior_flags.alpha : threshold;
             }
         }
 
-        auto* next_distribution = new NextDistribution(q_state_node->getRewards(q_state_node->getState()->turn), behavior_flags.consider_missing_outcomes);
+        auto* next_distribution = next_distribution_pool.create(q_state_node->getRewards(q_state_node->getState()->turn), behavior_flags.consider_missing_outcomes);
         double psum =0;
-        for (const auto& probability_successor : *q_state_node->getChildren() | std::views::values){
+        for (const auto& probability_successor : q_state_node->getChildren()){
             auto& [probability, successor] = probability_successor;
             assert (successor->getAbstractNode()->getCount() > 0);
             if (probability >= threshold) {
@@ -218,94 +303,74 @@ void OgaTree::updateQAbstractions(unsigned K, int depth, std::mt19937& rng, OgaS
         OgaAbstractQStateNode* new_abstract_q_state_node = old_abstract_q_state_node;
 
         // Determine new abstract node
-        assert (behavior_flags.q_abs_alg == "random" || behavior_flags.q_abs_alg == "eps");
-        if (behavior_flags.q_abs_alg == "random"){
+        if (behavior_flags.resolved_q_abs_alg == QAbsAlg::RANDOM){
             if (!q_state_node->hasReceivedAbsUpdate() && q_state_node->getAbstractNode()->getCount() <= 1){
                 if (std::bernoulli_distribution(behavior_flags.equiv_chance)(rng)){
-                        auto it = abstract_q_state_nodes[depth].begin();
-                        std::advance(it, std::uniform_int_distribution<size_t>(0, abstract_q_state_nodes[depth].size() - 1)(rng));
-                        new_abstract_q_state_node = *it;
+                        new_abstract_q_state_node = layers[depth].abstract_q_state_nodes.at(std::uniform_int_distribution<size_t>(0, layers[depth].abstract_q_state_nodes.size() - 1)(rng));
                 }
             }
-            delete next_distribution;
+            next_distribution_pool.destroy(next_distribution);
         }
         else {
 
-            [[maybe_unused]] bool contains_rep = next_distribution_map[depth].contains(old_abstract_q_state_node->getRepresentant());
+            [[maybe_unused]] bool contains_rep = layers[depth].next_distribution_map.contains(old_abstract_q_state_node->getRepresentant());
             assert (contains_rep || old_abstract_q_state_node->getRepresentant() == q_state_node); //if !contains_rep then fresh q-node
             if (old_abstract_q_state_node->getRepresentant() == q_state_node && contains_rep) { //Try merging with bigger abs nodes.
 
                //Find biggest abs node that current abs node can merge with
-                OgaAbstractQStateNode* merge = nullptr;
-                for (auto it = abstract_q_state_nodes[depth].rbegin() ; it != abstract_q_state_nodes[depth].rend(); ++it){ //sorted by abs size
-                    auto abs_other_node = *it;
-                    if (!next_distribution_map[depth].contains(abs_other_node->getRepresentant()))
-                        continue;
-                    assert (abs_other_node->getRepresentant() != nullptr && abs_other_node->getCount() > 0 && abs_other_node->getRepresentant()->getAbstractNode() == abs_other_node);
-                    bool approx = next_distribution->approxEqual(next_distribution_map[depth].at(abs_other_node->getRepresentant()), behavior_flags.eps_a, behavior_flags.eps_t);
-                    if (approx) {
-                        merge = abs_other_node;
-                        break;
-                    }
-                }
+                OgaAbstractQStateNode* merge = findMergeCandidate(next_distribution, depth, search_stats);
 
                 if (merge != nullptr && merge != old_abstract_q_state_node) {
                     new_abstract_q_state_node = merge;
                 }else if (merge == nullptr) { //Create new abstract node
                     if (old_abstract_q_state_node->getCount() > 1)
-                        new_abstract_q_state_node = new OgaAbstractQStateNode(depth, search_stats);
+                        new_abstract_q_state_node = abstract_q_state_pool.create(depth, search_stats);
                     else// Recycle old state
                         new_abstract_q_state_node = old_abstract_q_state_node;
                 }
 
             }
-            else if ( !contains_rep || !next_distribution->approxEqual(next_distribution_map[depth].at(old_abstract_q_state_node->getRepresentant()), behavior_flags.eps_a, behavior_flags.eps_t)) {
+            else if ( !contains_rep || !approxEqual(next_distribution, layers[depth].next_distribution_map.at(old_abstract_q_state_node->getRepresentant()), search_stats)) {
 
                 //find new matching abstract node with minimal distance
-                double min_dist = std::numeric_limits<double>::infinity();
-                unsigned min_id = -1;
-                OgaAbstractQStateNode* min_dist_node = nullptr;
-                for (auto abs_other_node : abstract_q_state_nodes[depth]) {
-                    if ((abs_other_node->getRepresentant() == q_state_node && !contains_rep) || !next_distribution_map[depth].contains(abs_other_node->getRepresentant()))
-                        continue;
-                    assert (abs_other_node->getRepresentant() != q_state_node && abs_other_node->getRepresentant() != nullptr && abs_other_node->getCount() > 0 && abs_other_node->getRepresentant()->getAbstractNode() == abs_other_node);
-                    double dist = next_distribution->dist(next_distribution_map[depth].at(abs_other_node->getRepresentant()));
-                    if ( dist < min_dist - 1e-6 || ( std::fabs(dist - min_dist) <= 1e-6 && abs_other_node->getId() < min_id)) {
-                        min_dist = dist;
-                        min_id = abs_other_node->getId();
-                        min_dist_node = abs_other_node;
-                    }
-                }
+                double min_dist;
+                OgaAbstractQStateNode* min_dist_node = findMinDistCandidate(next_distribution, depth, min_dist, search_stats);
                 //No match found?
-                bool transferrable = min_dist_node != nullptr && next_distribution->approxEqual(next_distribution_map[depth].at(min_dist_node->getRepresentant()), behavior_flags.eps_a, behavior_flags.eps_t);
+                bool transferrable = min_dist_node != nullptr && approxEqual(next_distribution, layers[depth].next_distribution_map.at(min_dist_node->getRepresentant()), search_stats);
                 bool create_new_abs_node = min_dist != std::numeric_limits<double>::infinity() && !transferrable;
 
                 // Create new abstract node
                 if (create_new_abs_node) {
                     if (old_abstract_q_state_node->getCount() > 1)
-                        new_abstract_q_state_node = new OgaAbstractQStateNode(depth, search_stats);
+                        new_abstract_q_state_node = abstract_q_state_pool.create(depth, search_stats);
                     else // Recycle old state
                        new_abstract_q_state_node = old_abstract_q_state_node;
                 } else if (transferrable)
                     new_abstract_q_state_node = min_dist_node;
 
             }else {
-               assert (next_distribution_map.at(depth).contains(q_state_node));
+               assert (layers[depth].next_distribution_map.contains(q_state_node));
             }
 
-            auto old_distr = next_distribution_map.at(depth)[q_state_node];
-            delete old_distr;
-            next_distribution_map.at(depth)[q_state_node] = next_distribution;
+            auto old_distr = layers[depth].next_distribution_map[q_state_node];
+            next_distribution_pool.destroy(old_distr);
+            layers[depth].next_distribution_map[q_state_node] = next_distribution;
+            updateCandidateIndex(q_state_node->getAbstractNode(), depth);
         }
 
         q_state_node->setReceivedAbsUpdate(true);
         bool abstract_node_changed = (old_abstract_q_state_node != new_abstract_q_state_node) || (q_state_node->getVisits() == K);
         if (abstract_node_changed) {
-            assert (abstract_q_state_nodes[depth].contains(old_abstract_q_state_node));
+            assert (layers[depth].abstract_q_state_nodes.contains(old_abstract_q_state_node));
             assert (old_abstract_q_state_node->getCount() > 0);
-            OgaAbstractQStateNode::transfer(q_state_node, old_abstract_q_state_node, new_abstract_q_state_node, abstract_q_state_nodes[depth], behavior_flags);
-            if (old_abstract_q_state_node->getCount() == 0)
-                abstract_q_corpses.insert(old_abstract_q_state_node);
+            OgaAbstractQStateNode::transfer(q_state_node, old_abstract_q_state_node, new_abstract_q_state_node, layers[depth].abstract_q_state_nodes, behavior_flags);
+            OGA_TELEMETRY_COUNT(search_stats, q_transfers, 1);
+            if (behavior_flags.resolved_q_abs_alg == QAbsAlg::EPS) { // Transfers may change the representants
+                updateCandidateIndex(old_abstract_q_state_node, depth);
+                updateCandidateIndex(new_abstract_q_state_node, depth);
+            }
+            if (old_abstract_q_state_node->getCount() == 0) // Nothing references the empty node anymore, recycle it
+                abstract_q_state_pool.destroy(old_abstract_q_state_node);
         }
 
         if (abstract_node_changed)
@@ -315,12 +380,127 @@ void OgaTree::updateQAbstractions(unsigned K, int depth, std::mt19937& rng, OgaS
 
 }
 
+bool OgaTree::approxEqual(const NextDistribution* next_distribution, const NextDistribution* other_distribution, OgaSearchStats& search_stats) const {
+    OGA_TELEMETRY_COUNT(search_stats, approx_equal_calls, 1);
+    return next_distribution->approxEqual(other_distribution, behavior_flags.eps_a, behavior_flags.eps_t);
+}
+
+void OgaTree::updateCandidateIndex(OgaAbstractQStateNode* abstract_node, int depth) {
+    const NextDistribution* representant_distribution = nullptr;
+    if (abstract_node->getCount() > 0) {
+        if (const auto it = layers[depth].next_distribution_map.find(abstract_node->getRepresentant()); it != layers[depth].next_distribution_map.end())
+            representant_distribution = it->second;
+    }
+    layers[depth].abstract_q_index.update(abstract_node, representant_distribution);
+}
+
+/*
+ * Returns the biggest abstract node (ties broken by smaller id) whose representant's distribution is approximately equal to next_distribution.
+ * Only abstract nodes within the reward window of eps_a whose signature allows a transition distance of at most eps_t are compared.
+ */
+OgaAbstractQStateNode* OgaTree::findMergeCandidate(const NextDistribution* next_distribution, int depth, OgaSearchStats& search_stats) {
+    const double rewards = next_distribution->getRewards();
+    const double reward_radius = behavior_flags.eps_a + 1e-6 + CANDIDATE_SLACK;
+
+    std::vector<OgaAbstractQStateNode*> candidates;
+    for (auto it = layers[depth].abstract_q_index.lowerBound(rewards - reward_radius); it != layers[depth].abstract_q_index.end() && it->first <= rewards + reward_radius; ++it) {
+        auto* abs_other_node = it->second;
+        assert (abs_other_node->getRepresentant() != nullptr && abs_other_node->getCount() > 0 && abs_other_node->getRepresentant()->getAbstractNode() == abs_other_node);
+        const auto* other_distribution = layers[depth].next_distribution_map.at(abs_other_node->getRepresentant());
+        if (next_distribution->transDistLowerBound(other_distribution) - behavior_flags.eps_t < 1e-6 + CANDIDATE_SLACK)
+            candidates.push_back(abs_other_node);
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [](const OgaAbstractQStateNode* lhs, const OgaAbstractQStateNode* rhs) {
+        return AbsQCompare{}(rhs, lhs); //sorted by abs size, descending
+    });
+    for (auto* abs_other_node : candidates) {
+        if (approxEqual(next_distribution, layers[depth].next_distribution_map.at(abs_other_node->getRepresentant()), search_stats))
+            return abs_other_node;
+    }
+    return nullptr;
+}
+
+/*
+ * Returns the abstract node whose representant's distribution has minimal distance to next_distribution. Distances within 1e-6 count as tie,
+ * resolved as by a linear scan over abstract_q_state_nodes that keeps the smaller id.
+ * The index is walked outwards from the reward of next_distribution, and only candidates whose distance lower bound is within MIN_DIST_BAND
+ * of the minimum are evaluated. If these near-minimal distances are too dense to be separated from the rest, the full scan is used instead.
+ */
+OgaAbstractQStateNode* OgaTree::findMinDistCandidate(const NextDistribution* next_distribution, int depth, double& min_dist, OgaSearchStats& search_stats) {
+    const auto& index = layers[depth].abstract_q_index;
+    const double rewards = next_distribution->getRewards();
+
+    std::vector<std::pair<double, OgaAbstractQStateNode*>> evaluated; //distance, abstract node
+    double lowest_dist = std::numeric_limits<double>::infinity();
+    auto evaluate = [&](OgaAbstractQStateNode* abs_other_node, double reward_dist) {
+        const auto* other_distribution = layers[depth].next_distribution_map.at(abs_other_node->getRepresentant());
+        if (std::max(reward_dist, next_distribution->transDistLowerBound(other_distribution)) > lowest_dist + MIN_DIST_BAND)
+            return;
+        OGA_TELEMETRY_COUNT(search_stats, dist_calls, 1);
+        const double dist = next_distribution->dist(other_distribution);
+        lowest_dist = std::min(lowest_dist, dist);
+        evaluated.emplace_back(dist, abs_other_node);
+    };
+
+    auto up = index.lowerBound(rewards);
+    auto down = std::make_reverse_iterator(up);
+    while (true) {
+        const bool up_open = up != index.end() && up->first - rewards <= lowest_dist + MIN_DIST_BAND;
+        const bool down_open = down != std::make_reverse_iterator(index.begin()) && rewards - down->first <= lowest_dist + MIN_DIST_BAND;
+        if (up_open && (!down_open || up->first - rewards <= rewards - down->first)) {
+            evaluate(up->second, up->first - rewards);
+            ++up;
+        } else if (down_open) {
+            evaluate(down->second, rewards - down->first);
+            ++down;
+        } else
+            break;
+    }
+
+    // All distances up to a cut-off must be evaluated and separated by a gap of more than 1e-6 from the rest. Otherwise, fall back to a full scan.
+    std::vector<double> dists;
+    for (const auto& [dist, abs_other_node] : evaluated)
+        dists.push_back(dist);
+    std::sort(dists.begin(), dists.end());
+    bool separated = false;
+    for (size_t i = 0; i < dists.size() && dists[i] + 1e-6 < lowest_dist + MIN_DIST_BAND - CANDIDATE_SLACK; i++) {
+        if (i + 1 == dists.size() || dists[i + 1] > dists[i] + 1e-6) {
+            separated = true;
+            break;
+        }
+    }
+    if (!separated && !evaluated.empty()) {
+        evaluated.clear();
+        OGA_TELEMETRY_COUNT(search_stats, dist_calls, index.size());
+        for (auto it = index.begin(); it != index.end(); ++it)
+            evaluated.emplace_back(next_distribution->dist(layers[depth].next_distribution_map.at(it->second->getRepresentant())), it->second);
+    }
+
+    // Same comparison as a scan over abstract_q_state_nodes
+    std::sort(evaluated.begin(), evaluated.end(), [](const auto& lhs, const auto& rhs) {
+        return AbsQCompare{}(lhs.second, rhs.second);
+    });
+    min_dist = std::numeric_limits<double>::infinity();
+    unsigned min_id = -1;
+    OgaAbstractQStateNode* min_dist_node = nullptr;
+    for (const auto& [dist, abs_other_node] : evaluated) {
+        assert (abs_other_node->getRepresentant() != nullptr && abs_other_node->getCount() > 0 && abs_other_node->getRepresentant()->getAbstractNode() == abs_other_node);
+        if ( dist < min_dist - 1e-6 || ( std::fabs(dist - min_dist) <= 1e-6 && abs_other_node->getId() < min_id)) {
+            min_dist = dist;
+            min_id = abs_other_node->getId();
+            min_dist_node = abs_other_node;
+        }
+    }
+    return min_dist_node;
+}
+
 void OgaTree::update_next_distrs(OgaStateNode* node, OgaSearchStats& search_stats) {
 
-    auto next_distr = new NextAbstractQStates();
-    auto next_filtered_distr = new NextAbstractQStates();
+    auto next_distr = next_abstract_q_states_pool.create();
+    auto next_filtered_distr = next_abstract_q_states_pool.create();
 
-    if (behavior_flags.state_abs_alg == "asap") {
+    if (behavior_flags.resolved_state_abs_alg == StateAbsAlg::ASAP) {
         for (auto* q_state : node->getChildren()){
             assert (q_state->getAbstractNode()->getCount() > 0);
             next_distr->addAbstractQState(q_state->getAbstractNode());
@@ -334,12 +514,12 @@ void OgaTree::update_next_distrs(OgaStateNode* node, OgaSearchStats& search_stat
 }
 
 bool OgaTree::distrSimilarity(NextAbstractQStates* nd1, NextAbstractQStates* nf1, NextAbstractQStates* nd2, NextAbstractQStates* nf2, OgaStateNode* s1, OgaStateNode* s2 ) {
-    for (auto* state : nf1->getStates()){
-        if (!nd2->getStates().contains(state))
+    for (const unsigned id : nf1->getIds()){
+        if (!nd2->contains(id))
             return false;
     }
-    for (auto* state : nf2->getStates()){
-        if (!nd1->getStates().contains(state))
+    for (const unsigned id : nf2->getIds()){
+        if (!nd1->contains(id))
             return false;
     }
 
@@ -348,14 +528,10 @@ bool OgaTree::distrSimilarity(NextAbstractQStates* nd1, NextAbstractQStates* nf1
 
 void OgaTree::updateStateAbstractions(unsigned K, int depth, OgaSearchStats& search_stats, std::mt19937& rng) {
 
-    //Sort by id for reproducibility (for eps > 0 case this might make a difference)
-    std::vector<OgaStateNode*> sorted_to_update_nodes = std::vector(to_update_states[depth].begin(), to_update_states[depth].end());
-    std::sort(sorted_to_update_nodes.begin(), sorted_to_update_nodes.end(),
-              [](const OgaStateNode* lhs, const OgaStateNode* rhs) {
-                  return lhs->getId() < rhs->getId();  // Sort by ID
-              });
+    //Visited in id order for reproducibility (for eps > 0 case this might make a difference). Updates only stage nodes of other sets.
+    OGA_TELEMETRY_STAGED(search_stats, staged_states, depth, layers[depth].to_update_states.size());
 
-    for (auto* state_node : sorted_to_update_nodes){
+    for (auto* state_node : layers[depth].to_update_states){
 
         state_node->resetRecencyCount();
 
@@ -365,53 +541,50 @@ void OgaTree::updateStateAbstractions(unsigned K, int depth, OgaSearchStats& sea
 
         OgaAbstractStateNode* old_abstract_state_node = state_node->getAbstractNode();
         assert (old_abstract_state_node == nullptr || state_node->getAbstractNode()->getCount() > 0);
-        assert (old_abstract_state_node == nullptr || abstract_state_nodes[depth].contains(old_abstract_state_node));
+        assert (old_abstract_state_node == nullptr || layers[depth].abstract_state_nodes.contains(old_abstract_state_node));
 
         OgaAbstractStateNode* new_abstract_state_node = old_abstract_state_node;
 
-        if (behavior_flags.state_abs_alg == "random"){
+        if (behavior_flags.resolved_state_abs_alg == StateAbsAlg::RANDOM){
              if (!state_node->hasReceivedAbsUpdate() && state_node->getAbstractNode()->getCount() <= 1){
                 if (std::bernoulli_distribution(behavior_flags.equiv_chance)(rng)){
-                    auto term_abs_node = static_cast<int>(terminal_abstract_state_nodes.size()) > depth ? terminal_abstract_state_nodes[depth] : nullptr;
+                    auto term_abs_node = layers[depth].terminal_abstract_state_node;
                     new_abstract_state_node = term_abs_node;
-                    assert (abstract_state_nodes[depth].size() > 1 || term_abs_node == nullptr);
+                    assert (layers[depth].abstract_state_nodes.size() > 1 || term_abs_node == nullptr);
                     while (new_abstract_state_node == term_abs_node) {
-                        auto it = abstract_state_nodes[depth].begin();
-                        std::advance(it, std::uniform_int_distribution<size_t>(0, abstract_state_nodes[depth].size() - 1)(rng));
-                        new_abstract_state_node = *it;
+                        new_abstract_state_node = layers[depth].abstract_state_nodes.at(std::uniform_int_distribution<size_t>(0, layers[depth].abstract_state_nodes.size() - 1)(rng));
                     }
                 }
             }
-        } else if (behavior_flags.state_abs_alg != "asap"){ //this computation branch would be equivlent to asap but for asap there is a more efficient way to compute it
+        } else if (behavior_flags.resolved_state_abs_alg != StateAbsAlg::ASAP){ //this computation branch would be equivlent to asap but for asap there is a more efficient way to compute it
 
             bool is_repr = state_node->getAbstractNode()->getRepresentant() == state_node;
-            bool is_partial = (behavior_flags.group_partially_expanded_states && state_node->getAbstractNode() == unexplored_abstract_state_nodes[depth]);
+            bool is_partial = (behavior_flags.group_partially_expanded_states && state_node->getAbstractNode() == layers[depth].unexplored_abstract_state_node);
 
             assert (!(state_node->getLastNextDistr() == nullptr && !is_repr && !is_partial));
 
             auto representant_distr = state_node->getAbstractNode()->getRepresentant()->getLastNextDistr();
             auto representant_filtered_distr = state_node->getAbstractNode()->getRepresentant()->getLastFilteredNextDistr();
             if (state_node != state_node->getAbstractNode()->getRepresentant()) {
-                delete state_node->getLastFilteredNextDistr();
-                delete state_node->getLastNextDistr();
+                next_abstract_q_states_pool.destroy(state_node->getLastFilteredNextDistr());
+                next_abstract_q_states_pool.destroy(state_node->getLastNextDistr());
             }
             update_next_distrs(state_node,search_stats);
 
             bool no_match = representant_distr != nullptr && !distrSimilarity(state_node->getLastNextDistr(),state_node->getLastFilteredNextDistr(),representant_distr,representant_filtered_distr, state_node, state_node->getAbstractNode()->getRepresentant());
             if (state_node == state_node->getAbstractNode()->getRepresentant()) {
-                delete representant_distr;
-                delete representant_filtered_distr;
+                next_abstract_q_states_pool.destroy(representant_distr);
+                next_abstract_q_states_pool.destroy(representant_filtered_distr);
             }
 
             if (is_repr || no_match || is_partial){
                 //find biggest matching abs node
                 OgaAbstractStateNode* merge = nullptr;
-                for (auto it = abstract_state_nodes[depth].rbegin() ; it != abstract_state_nodes[depth].rend(); ++it){ //sorted by abs size and id
-                    auto other = *it;
+                for (auto* other : layers[depth].abstract_state_nodes.descending()){ //sorted by abs size and id
                     auto repr = other->getRepresentant();
                     assert (repr != nullptr && other->getCount() > 0);
 
-                    if ( (behavior_flags.group_partially_expanded_states && other == unexplored_abstract_state_nodes[depth]) || repr == state_node || repr->getLastNextDistr() == nullptr)
+                    if ( (behavior_flags.group_partially_expanded_states && other == layers[depth].unexplored_abstract_state_node) || repr == state_node || repr->getLastNextDistr() == nullptr)
                         continue;
                     if ( (merge != nullptr && merge->getCount() > other->getCount()) || (merge != nullptr && merge->getCount() == other->getCount() && merge->getId() < other->getId()))
                         break;
@@ -423,24 +596,26 @@ void OgaTree::updateStateAbstractions(unsigned K, int depth, OgaSearchStats& sea
                 if (merge != nullptr)
                     new_abstract_state_node = merge;
                 else if (is_partial || (no_match && old_abstract_state_node->getCount() > 1))  //Create new abstract node
-                    new_abstract_state_node = new OgaAbstractStateNode(depth, search_stats);
+                    new_abstract_state_node = abstract_state_pool.create(depth, search_stats);
             }
 
         }else{
-            auto* next_abstract_q_states = new NextAbstractQStates();
+            // Look the signature up with the reusable probe, only new signatures are interned as keys of abstract_state_node_map
+            next_abstract_q_states_probe.clear();
             for (const auto* q_state : state_node->getChildren()){
                 assert (q_state->getAbstractNode()->getCount() > 0);
-                next_abstract_q_states->addAbstractQState(q_state->getAbstractNode());
+                next_abstract_q_states_probe.addAbstractQState(q_state->getAbstractNode());
             }
 
-            bool exists = abstract_state_node_map[depth].contains(next_abstract_q_states);
-            assert (!exists || abstract_state_node_map[depth][next_abstract_q_states]->getCount() > 0);
+            const auto it = layers[depth].abstract_state_node_map.find(&next_abstract_q_states_probe);
+            assert (it == layers[depth].abstract_state_node_map.end() || it->second->getCount() > 0);
 
-            if (!exists){
+            if (it == layers[depth].abstract_state_node_map.end()){
+                auto* next_abstract_q_states = next_abstract_q_states_pool.create(next_abstract_q_states_probe);
 
                 if (old_abstract_state_node->getCount() > 1 ||
-                    (behavior_flags.group_partially_expanded_states && old_abstract_state_node == unexplored_abstract_state_nodes[depth])){
-                    new_abstract_state_node = new OgaAbstractStateNode(depth, search_stats);
+                    (behavior_flags.group_partially_expanded_states && old_abstract_state_node == layers[depth].unexplored_abstract_state_node)){
+                    new_abstract_state_node = abstract_state_pool.create(depth, search_stats);
                     [[maybe_unused]] auto* old_key = new_abstract_state_node->popAndSetKey(next_abstract_q_states);
                     assert(old_key == nullptr);
                 }
@@ -448,36 +623,37 @@ void OgaTree::updateStateAbstractions(unsigned K, int depth, OgaSearchStats& sea
                     new_abstract_state_node = old_abstract_state_node;
                     auto* old_next_abstract_q_states = static_cast<NextAbstractQStates*>(old_abstract_state_node->popAndSetKey(next_abstract_q_states));
                     if (old_next_abstract_q_states != nullptr){
-                        abstract_state_node_map[depth].erase(old_next_abstract_q_states);
-                        delete old_next_abstract_q_states;
+                        layers[depth].abstract_state_node_map.erase(old_next_abstract_q_states);
+                        next_abstract_q_states_pool.destroy(old_next_abstract_q_states);
                     }
                 }
 
-                abstract_state_node_map[depth][next_abstract_q_states] = new_abstract_state_node;
-            }
-            else{
-                new_abstract_state_node = abstract_state_node_map[depth][next_abstract_q_states];
-                delete next_abstract_q_states;
+                layers[depth].abstract_state_node_map[next_abstract_q_states] = new_abstract_state_node;
             }
+            else
+                new_abstract_state_node = it->second;
 
         }
 
         // Transfer abstract nodes
         bool abstract_node_changed = old_abstract_state_node != new_abstract_state_node;
         if (abstract_node_changed) {
-            OgaAbstractStateNode::transfer(state_node, old_abstract_state_node, new_abstract_state_node, abstract_state_nodes[depth]);
+            OgaAbstractStateNode::transfer(state_node, old_abstract_state_node, new_abstract_state_node, layers[depth].abstract_state_nodes);
+            OGA_TELEMETRY_COUNT(search_stats, state_transfers, 1);
             if (old_abstract_state_node->getCount() == 0) {
-                abstract_state_nodes[depth].erase(old_abstract_state_node);
-                abstract_state_corpses.insert(old_abstract_state_node);
+                layers[depth].abstract_state_nodes.erase(old_abstract_state_node);
                 if (old_abstract_state_node->getKey() != nullptr) { //nullptr happens when a freshly inited node gets directly moved to a bigger abs node
                     auto *old_key = static_cast<NextAbstractQStates*>(old_abstract_state_node->popAndSetKey(nullptr));
-                    assert(old_key != nullptr && abstract_state_node_map[depth].contains(old_key) && abstract_state_node_map[depth][old_key] == old_abstract_state_node);
-                    abstract_state_node_map[depth].erase(old_key);
-                    delete old_key;
+                    assert(old_key != nullptr && layers[depth].abstract_state_node_map.contains(old_key) && layers[depth].abstract_state_node_map[old_key] == old_abstract_state_node);
+                    layers[depth].abstract_state_node_map.erase(old_key);
+                    next_abstract_q_states_pool.destroy(old_key);
                 }
-                if (behavior_flags.group_partially_expanded_states && unexplored_abstract_state_nodes[depth] == old_abstract_state_node){
-                    unexplored_abstract_state_nodes[depth] = nullptr;
+                if (behavior_flags.group_partially_expanded_states && layers[depth].unexplored_abstract_state_node == old_abstract_state_node){
+                    layers[depth].unexplored_abstract_state_node = nullptr;
                 }
+                // Recycle the empty node. The terminal abstract node is kept, later terminal states of this depth join it again.
+                if (old_abstract_state_node != layers[depth].terminal_abstract_state_node)
+                    abstract_state_pool.destroy(old_abstract_state_node);
             }
         }
 
@@ -493,19 +669,17 @@ void OgaTree::updateStateAbstractions(unsigned K, int depth, OgaSearchStats& sea
 
 void OgaTree::performUpdateAbstractions(unsigned K, OgaSearchStats& search_stats, std::mt19937& rng){
 
-    assert (behavior_flags.state_abs_alg != "asap" || to_update_q_states.size() >= to_update_states.size());
-    for (int depth = static_cast<int>(std::max(to_update_q_states.size(),to_update_states.size())) - 1; depth >= 0; depth--){
-        if (depth < static_cast<int>(to_update_q_states.size()))
-            updateQAbstractions(K, depth, rng, search_stats);
-        if (depth < static_cast<int>(to_update_states.size()))
-            updateStateAbstractions(K, depth,search_stats, rng);
-    }
+    // Updates of a depth only stage nodes of the same or the next lower depth, so the dirty depths can be visited from the deepest one downwards
+    for (int depth = deepestDirtyDepth(static_cast<int>(layers.size()) - 1); depth >= 0; depth = deepestDirtyDepth(depth - 1)){
+        updateQAbstractions(K, depth, rng, search_stats);
+        updateStateAbstractions(K, depth,search_stats, rng);
 
-    // Clear all update sets
-    for (auto& update_set : to_update_q_states)
-        update_set.clear();
-    for (auto& update_set : to_update_states)
-        update_set.clear();
+        num_staged -= layers[depth].to_update_q_states.size() + layers[depth].to_update_states.size();
+        layers[depth].to_update_q_states.clear();
+        layers[depth].to_update_states.clear();
+        dirty_depths[depth / 64] &= ~(uint64_t{1} << (depth % 64));
+    }
+    assert (num_staged == 0);
 }
 
 void OgaTree::addUpdateQStateNodeAbstraction(OgaQStateNode* q_state_node){
@@ -537,10 +711,8 @@ void OgaTree::estimateValueEquivalentAbsStateRatio(std::unordered_map<std::pair<
             auto state_node1 = state_nodes[sample_idx1];
 
             //sample a second different state from the same abstract node
-            auto ground_nodes = state_node1->getAbstractNode()->getGroundNodes();
-            auto it = ground_nodes.begin();
-            std::advance(it, std::uniform_int_distribution<int>(0, ground_nodes.size() - 1)(rng));
-            auto state_node2 = *it;
+            const auto& ground_nodes = state_node1->getAbstractNode()->getGroundNodes();
+            auto state_node2 = ground_nodes[std::uniform_int_distribution<int>(0, ground_nodes.size() - 1)(rng)];
             if (state_node2->getState()->terminal)
                 throw std::runtime_error("Terminal state in abstract node");
 
@@ -577,16 +749,19 @@ void OgaTree::estimateValueEquivalentAbsStateRatio(std::unordered_map<std::pair<
 void OgaTree::updateStatistics(std::map<std::string,std::map<int,double>>& layerwise_statistics, std::map<std::string,double>& global_statistics, std::unordered_map<std::pair<FINITEH::Gamestate*,int> , double, VALUE_IT::QMapHash, VALUE_IT::QMapCompare>* Q_map, std::mt19937& rng) {
 
     //State node statistics
-    for (auto [depth,abs_layer] : abstract_state_nodes){
+    for (int depth = 0; depth < static_cast<int>(layers.size()); depth++){
+        const auto& abs_layer = layers[depth].abstract_state_nodes;
+        if (abs_layer.empty())
+            continue;
 
         int non_trivial_sizes_sum = 0;
         int non_trivial_num = 0;
         int trivial_num = 0;
         int total = 0;
 
-        for (auto abs_node : abs_layer) {
-            bool unexplored_abs = (int)unexplored_abstract_state_nodes.size() > depth && abs_node == unexplored_abstract_state_nodes[abs_node->getDepth()];
-            bool term_abs = (int)terminal_abstract_state_nodes.size() > depth && abs_node == terminal_abstract_state_nodes[abs_node->getDepth()];
+        abs_layer.forEach([&](OgaAbstractStateNode* abs_node) {
+            bool unexplored_abs = abs_node == layers[depth].unexplored_abstract_state_node;
+            bool term_abs = abs_node == layers[depth].terminal_abstract_state_node;
             bool received_update = false;
             for (const auto* state_node : abs_node->getGroundNodes()){
                 if (state_node->hasReceivedAbsUpdate()){
@@ -595,7 +770,7 @@ void OgaTree::updateStatistics(std::map<std::string,std::map<int,double>>& layer
                 }
             }
             if (unexplored_abs || term_abs || !received_update)
-                continue;
+                return;
 
             total++;
             if (abs_node->getCount() > 1) {
@@ -606,7 +781,7 @@ void OgaTree::updateStatistics(std::map<std::string,std::map<int,double>>& layer
             else
                 throw std::runtime_error("Invalid count");
 
-        }
+        });
 
         layerwise_statistics["non_trivial_state_abs_count_sum"][depth] += non_trivial_sizes_sum;
         layerwise_statistics["non_trivial_state_abs_num"][depth] += non_trivial_num;
@@ -615,14 +790,17 @@ void OgaTree::updateStatistics(std::map<std::string,std::map<int,double>>& layer
     }
 
     //Qnode statistics
-    for (auto [depth,abs_layer] : abstract_q_state_nodes){
+    for (int depth = 0; depth < static_cast<int>(layers.size()); depth++){
+        const auto& abs_layer = layers[depth].abstract_q_state_nodes;
+        if (abs_layer.empty())
+            continue;
 
         int non_trivial_sizes_sum = 0;
         int non_trivial_num = 0;
         int trivial_num = 0;
         int total = 0;
 
-        for (auto abs_node : abs_layer) {
+        abs_layer.forEach([&](OgaAbstractQStateNode* abs_node) {
 
             bool received_update = false;
             for (const auto* q_state_node : abs_node->getGroundNodes()){
@@ -632,7 +810,7 @@ void OgaTree::updateStatistics(std::map<std::string,std::map<int,double>>& layer
                 }
             }
             if (!received_update)
-                continue;
+                return;
 
             total++;
             if (abs_node->getCount() > 1) {
@@ -641,7 +819,7 @@ void OgaTree::updateStatistics(std::map<std::string,std::map<int,double>>& layer
             }else if (abs_node->getCount() == 1) {
                 trivial_num++;
             }
-        }
+        });
 
         layerwise_statistics["non_trivial_q_abs_count_sum"][depth] += non_trivial_sizes_sum;
         layerwise_statistics["non_trivial_q_abs_num"][depth] += non_trivial_num;
@@ -657,23 +835,20 @@ void OgaTree::updateStatistics(std::map<std::string,std::map<int,double>>& layer
 
 }
 
-void OgaTree::printAbsTree(ABS::Model* model, size_t layers) const {
+void OgaTree::printAbsTree(ABS::Model* model, size_t num_layers) const {
     // std::cout << "-------- OGA abs tree ------------ " << std::endl;
-    // for (size_t depth = 0; depth < abstract_state_nodes.size(); depth++) {
-    //     auto astates = abstract_state_nodes.at(depth);
+    // for (size_t depth = 0; depth < layers.size(); depth++) {
+    //     const auto& astates = layers[depth].abstract_state_nodes;
     //     std::cout << "Depth " << depth << " states:" << astates.size() << std::endl;
-    //     if (abstract_q_state_nodes.contains(depth)) {
-    //         auto qstates = abstract_q_state_nodes.at(depth);
-    //         std::cout << "Depth " << depth << " Q-states:" << qstates.size() << std::endl;
-    //     }
+    //     const auto& qstates = layers[depth].abstract_q_state_nodes;
+    //     std::cout << "Depth " << depth << " Q-states:" << qstates.size() << std::endl;
     // }
 
     std::cout << "-------- OGA abs tree ------------ " << std::endl;
 
-    for (size_t depth = 0; depth < std::min(layers,abstract_state_nodes.size()); depth++) {
+    for (size_t depth = 0; depth < std::min(num_layers,layers.size()); depth++) {
         std::cout << "Depth " << depth << " states:" << std::endl;
-        auto astates = abstract_state_nodes.at(depth);
-        for (auto* state_node : astates) {
+        layers[depth].abstract_state_nodes.forEach([&](OgaAbstractStateNode* state_node) {
             std::cout << " [ Repr:" << state_node->getRepresentant()->getId() << ", ";
 
             std::vector<OgaStateNode*> sorted_nodes = std::vector(state_node->getGroundNodes().begin(), state_node->getGroundNodes().end());
@@ -686,14 +861,13 @@ void OgaTree::printAbsTree(ABS::Model* model, size_t layers) const {
                 std::cout << state_node->getId() <<  ", ";
             }
             std::cout << " ]    ";
-        }
+        });
         std::cout << std::endl;
 
         std::cout << "Depth " << depth << " Q-states:" << std::endl;
-        if (abstract_q_state_nodes.find(depth) == abstract_q_state_nodes.end())
+        if (layers[depth].abstract_q_state_nodes.empty())
             continue;
-        auto aqstates = abstract_q_state_nodes.at(depth);
-        for (auto* q_state_node : aqstates) {
+        layers[depth].abstract_q_state_nodes.forEach([&](OgaAbstractQStateNode* q_state_node) {
             std::cout << " [ Repr: " << q_state_node->getRepresentant()->getId() << ", ";
 
             std::vector<OgaQStateNode*> sorted_nodes = std::vector(q_state_node->getGroundNodes().begin(), q_state_node->getGroundNodes().end());
@@ -706,23 +880,25 @@ void OgaTree::printAbsTree(ABS::Model* model, size_t layers) const {
                 std::cout << ground_q_state_node->getId() << ": (" << ground_q_state_node->getAction() << ", " << ground_q_state_node->getAbsValues() / (double) ground_q_state_node->getAbsVisits() << ", " << ground_q_state_node->getVisits() << "), ";
             }
             std::cout << " ]    ";
-        }
+        });
         std::cout << std::endl;
 
     }
 
     std::cout << "ABS Q Node set:" << std::endl;
-    for (const auto& [d,nodes] : abstract_q_state_nodes) {
+    for (size_t d = 0; d < layers.size(); d++) {
         std::cout << "Depth " << d << " states:" << std::endl;
-        for (const auto* state_node : nodes)
+        layers[d].abstract_q_state_nodes.forEach([](const OgaAbstractQStateNode* state_node) {
             std::cout << state_node->getId() << " | Repr:" << state_node->getRepresentant()->getId() << std::endl;
+        });
     }
 
     std::cout << "ABS State Node set:" << std::endl;
-    for (const auto& [d,nodes] : abstract_state_nodes) {
+    for (size_t d = 0; d < layers.size(); d++) {
         std::cout << "Depth " << d << " states:" << std::endl;
-        for (const auto* state_node : nodes)
+        layers[d].abstract_state_nodes.forEach([](const OgaAbstractStateNode* state_node) {
             std::cout << state_node->getId() << " | Repr:" << state_node->getRepresentant()->getId() << std::endl;
+        });
     }
 
 }
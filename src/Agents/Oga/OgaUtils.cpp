@@ -4,104 +4,179 @@
 #include "../../../include/Agents/Oga/OgaUtils.h"
 #include "../../../include/Agents/Oga/OgaAbstractNodes.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <cstdint>
 #include <fstream>
+#include <stdexcept>
 
 using namespace OGA;
 
+void OgaBehaviorFlags::resolveAlgorithms(){
+    if (q_abs_alg == "eps")
+        resolved_q_abs_alg = QAbsAlg::EPS;
+    else if (q_abs_alg == "random")
+        resolved_q_abs_alg = QAbsAlg::RANDOM;
+    else
+        throw std::runtime_error("Unknown q abs alg: " + q_abs_alg);
+
+    if (state_abs_alg == "asap")
+        resolved_state_abs_alg = StateAbsAlg::ASAP;
+    else if (state_abs_alg == "random")
+        resolved_state_abs_alg = StateAbsAlg::RANDOM;
+    else
+        throw std::runtime_error("Unknown state abs alg: " + state_abs_alg);
+}
+
 NextDistribution::NextDistribution(double rewards, bool consider_missing_outcomes) :
     rewards(rewards),
     consider_missing_outcomes(consider_missing_outcomes)
 {}
 
 void NextDistribution::addProbability(OgaAbstractStateNode* next_abstract_state_node, const double probability){
-    if (!distribution.contains(next_abstract_state_node))
-        distribution[next_abstract_state_node] = probability;
+    const unsigned id = next_abstract_state_node->getId();
+    auto it = std::lower_bound(distribution.begin(), distribution.end(), id, [](const Outcome& outcome, unsigned key) { return outcome.first < key; });
+    if (it == distribution.end() || it->first != id)
+        it = distribution.insert(it, {id, probability});
     else
-        distribution[next_abstract_state_node] += probability;
+        it->second += probability;
+    mass += probability;
+    max_probability = std::max(max_probability, it->second);
 }
 
 double NextDistribution::getRewards() const{
     return rewards;
 }
 
-const Map<OgaAbstractStateNode, double>& NextDistribution::getDistribution() const{
+const std::vector<NextDistribution::Outcome>& NextDistribution::getDistribution() const{
     return distribution;
 }
 
-inline double NextDistribution::rewardDist(const NextDistribution* other) const{
+double NextDistribution::rewardDist(const NextDistribution* other) const{
     return std::fabs(rewards - other->getRewards());
 }
 
-inline double NextDistribution::transDist(const NextDistribution* other) const {
-
-    Map<OgaAbstractStateNode,std::pair<bool,bool>> union_map;
-    for(const auto &abs_node: other->getDistribution() | std::views::keys)
-        union_map.insert({abs_node,{false,true}});
-    for(const auto &abs_node: distribution | std::views::keys) {
-        if(union_map.contains(abs_node))
-            union_map.at(abs_node).first = true;
-        else
-            union_map.insert({abs_node,{true,false}});
-    }
-
-    // double trans_dist = 0;
-    // double missing_p1 = 1.0;
-    // double missing_p2 = 1.0;
-    // for(auto [abs_node,occurences] : union_map) {
-    //     double p1 = occurences.first ? distribution.at(abs_node) : 0;
-    //     double p2 = occurences.second ? other->getDistribution().at(abs_node) : 0;
-    //     trans_dist += std::fabs(p1 - p2);
-    //     missing_p1 -= p1;
-    //     missing_p2 -= p2;
-    // }
+/*
+ * Merges both id-sorted distributions. Outcomes that only occur in one distribution contribute their full probability.
+ * Summation happens in id order, which is reproducible as abstract node ids are assigned deterministically.
+ */
+double NextDistribution::transDist(const NextDistribution* other, const double bound) const {
+    const auto& other_distribution = other->getDistribution();
+    const size_t n1 = distribution.size();
+    const size_t n2 = other_distribution.size();
 
     double trans_dist = 0;
-    double missing_p1 = 1.0;
-    double missing_p2 = 1.0;
-    std::set<std::tuple<double,double,int>> probs = {}; //Doing it this way it a bit slower, but we want reproducibility and iterating over union_map is undefined order
-    int ctr = 0;
-    for(auto [abs_node,occurences] : union_map) {
-        double p1 = occurences.first ? distribution.at(abs_node) : 0;
-        double p2 = occurences.second ? other->getDistribution().at(abs_node) : 0;
-        probs.insert({p1,p2, ctr++});
-    }
-    for (auto [p1,p2,ctr] : probs){
-        trans_dist += std::fabs(p1 - p2);
-        missing_p1 -= p1;
-        missing_p2 -= p2;
+    size_t i = 0, j = 0;
+    while (i < n1 && j < n2) {
+        const auto& [id1, p1] = distribution[i];
+        const auto& [id2, p2] = other_distribution[j];
+        const bool take1 = id1 <= id2;
+        const bool take2 = id2 <= id1;
+        trans_dist += std::fabs((take1 ? p1 : 0) - (take2 ? p2 : 0));
+        i += take1;
+        j += take2;
+        if (trans_dist > bound)
+            return trans_dist;
     }
+    for (; i < n1; i++)
+        trans_dist += distribution[i].second;
+    for (; j < n2; j++)
+        trans_dist += other_distribution[j].second;
 
     if (consider_missing_outcomes)
-        trans_dist += missing_p1 + missing_p2;
+        trans_dist += (1.0 - mass) + (1.0 - other->mass);
 
     return trans_dist;
 }
 
+/*
+ * Lower bound of transDist that only uses the signature of both distributions:
+ * The L1 distance is at least the difference of the total masses and at least the difference of the largest probabilities.
+ */
+double NextDistribution::transDistLowerBound(const NextDistribution* other) const {
+    double bound = std::max(std::fabs(mass - other->mass), std::fabs(max_probability - other->max_probability));
+    if (consider_missing_outcomes)
+        bound += std::max(0.0, 2.0 - mass - other->mass);
+    return bound;
+}
+
 double NextDistribution::dist(const NextDistribution* other) const {
     return std::max(rewardDist(other), transDist(other));
 }
 
 bool NextDistribution::approxEqual(const NextDistribution* other, double eps_a, double eps_t) const {
-    return std::max(rewardDist(other) -  eps_a, 0.0) < 1e-6 && std::max(transDist(other) - eps_t, 0.0) < 1e-6;
+    return std::max(rewardDist(other) -  eps_a, 0.0) < 1e-6 && std::max(transDist(other, eps_t + 1e-6) - eps_t, 0.0) < 1e-6;
+}
+
+// AbsQCandidateIndex
+
+bool AbsQCandidateIndex::EntryCompare::operator()(const Entry& lhs, const Entry& rhs) const{
+    if (lhs.first != rhs.first)
+        return lhs.first < rhs.first;
+    if (lhs.second == nullptr || rhs.second == nullptr) // nullptr is used as lower sentinel for lookups
+        return lhs.second == nullptr && rhs.second != nullptr;
+    return lhs.second->getId() < rhs.second->getId();
+}
+
+void AbsQCandidateIndex::update(OgaAbstractQStateNode* abstract_node, const NextDistribution* representant_distribution){
+    if (representant_distribution == nullptr){
+        remove(abstract_node);
+        return;
+    }
+    const double rewards = representant_distribution->getRewards();
+    if (const auto it = keys.find(abstract_node); it != keys.end()){
+        if (it->second == rewards)
+            return;
+        entries.erase({it->second, abstract_node});
+        it->second = rewards;
+    }else
+        keys.insert({abstract_node, rewards});
+    entries.insert({rewards, abstract_node});
+}
+
+void AbsQCandidateIndex::remove(OgaAbstractQStateNode* abstract_node){
+    if (const auto it = keys.find(abstract_node); it != keys.end()){
+        entries.erase({it->second, abstract_node});
+        keys.erase(it);
+    }
+}
+
+AbsQCandidateIndex::Iterator AbsQCandidateIndex::lowerBound(const double rewards) const{
+    return entries.lower_bound({rewards, nullptr});
 }
 
 // NextAbstractQStates
-void NextAbstractQStates::addAbstractQState(OgaAbstractQStateNode* next_abstract_q_state_node){
-    states.insert(next_abstract_q_state_node);
+void NextAbstractQStates::addAbstractQState(const OgaAbstractQStateNode* next_abstract_q_state_node){
+    const unsigned id = next_abstract_q_state_node->getId();
+    const auto it = std::lower_bound(ids.begin(), ids.end(), id);
+    if (it == ids.end() || *it != id) {
+        ids.insert(it, id);
+        // splitmix64 finalizer
+        uint64_t mixed = id + 0x9e3779b97f4a7c15ULL;
+        mixed = (mixed ^ (mixed >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        mixed = (mixed ^ (mixed >> 27)) * 0x94d049bb133111ebULL;
+        ids_hash += mixed ^ (mixed >> 31);
+    }
+}
+
+void NextAbstractQStates::clear(){
+    ids.clear();
+    ids_hash = 0;
+}
+
+const std::vector<unsigned>& NextAbstractQStates::getIds() const{
+    return ids;
 }
 
-const Set<OgaAbstractQStateNode>& NextAbstractQStates::getStates() const{
-    return states;
+bool NextAbstractQStates::contains(const unsigned id) const{
+    return std::binary_search(ids.begin(), ids.end(), id);
 }
 
 bool NextAbstractQStates::operator==(const NextAbstractQStates& other) const{
-    return states == other.getStates();
+    return ids_hash == other.ids_hash && ids == other.getIds();
 }
 
 size_t NextAbstractQStates::hash() const{
-    size_t hash = 0;
-    for (const auto* next_abstract_q_state_node : states)
-        hash ^= next_abstract_q_state_node->hash();
-    return hash;
+    return ids_hash;
 }
@@ -1,6 +1,8 @@
 
+#include <map>
 #include <random>
 #include <ranges>
+#include <set>
 
 #include "../../../include/Agents/Oga/OgaAgent.h"
 #include "../../../include/Agents/Oga/OgaTree.h"
@@ -165,6 +167,289 @@ namespace OGA
         std::cout << "- Simple group horizon test done" << std::endl;
     }
 
+    /*
+     * Test that the nodes of a reused tree can still be regrouped by the random abstraction algorithms, which only regroup nodes
+     * that have not received an abstraction update yet.
+     */
+    void reuseRandomAbstractionTest()
+    {
+        auto agent = OGA::OgaAgent(
+            OGA::OgaArgs{
+                .budget = {1000, "iterations"},
+                .recency_count_limit = 3,
+                .exploration_parameter = 1.0,
+                .discount = 1.0,
+                .behavior_flags = {.group_terminal_states = false, .q_abs_alg = "random", .state_abs_alg = "random", .equiv_chance = 1.0}
+            });
+        auto model = FINITEH::Model(new Navigation::Model("../resources/NavigationMaps/1_IPPC.txt",false),10,true);
+        auto rng = std::mt19937(42);
+
+        const auto state = model.getInitialState(rng);
+        OGA::OgaTree* tree;
+        agent.getAction(&model, state, rng, &tree);
+
+        // Reuse the largest subtree
+        const OGA::OgaStateNode* new_root = nullptr;
+        for (const auto* q_state_node : tree->getRoot()->getChildren()) {
+            for (const auto& [probability, successor] : q_state_node->getChildren()) {
+                if (new_root == nullptr || successor->getVisits() > new_root->getVisits())
+                    new_root = successor;
+            }
+        }
+        OGA::OgaSearchStats search_stats = {{1000, "iterations"}};
+        auto* reused_tree = new OGA::OgaTree(*tree, new_root, &model, search_stats);
+
+        // Collects all ground nodes of the reused tree
+        std::vector<const OGA::OgaStateNode*> state_nodes = {reused_tree->getRoot()};
+        std::vector<const OGA::OgaQStateNode*> q_state_nodes;
+        std::set<const OGA::OgaStateNode*> discovered = {reused_tree->getRoot()};
+        for (size_t i = 0; i < state_nodes.size(); i++) {
+            for (const auto* q_state_node : state_nodes[i]->getChildren()) {
+                q_state_nodes.push_back(q_state_node);
+                for (const auto& [probability, successor] : q_state_node->getChildren()) {
+                    if (discovered.insert(successor).second)
+                        state_nodes.push_back(successor);
+                }
+            }
+        }
+        ASSERT_TRUE(q_state_nodes.size() > 1);
+
+        bool all_fresh = true;
+        for (const auto* state_node : state_nodes)
+            all_fresh = all_fresh && !state_node->hasReceivedAbsUpdate();
+        for (const auto* q_state_node : q_state_nodes)
+            all_fresh = all_fresh && !q_state_node->hasReceivedAbsUpdate();
+        ASSERT_TRUE(all_fresh);
+
+        // With equiv_chance = 1, every fresh node joins a random abstract node of its depth, so some abstract nodes are no singletons
+        reused_tree->performUpdateAbstractions(3, search_stats, rng);
+        bool q_states_grouped = false;
+        for (const auto* q_state_node : q_state_nodes)
+            q_states_grouped = q_states_grouped || q_state_node->getAbstractNode()->getCount() > 1;
+        ASSERT_TRUE(q_states_grouped);
+        bool states_grouped = false;
+        for (const auto* state_node : state_nodes)
+            states_grouped = states_grouped || state_node->getAbstractNode()->getCount() > 1;
+        ASSERT_TRUE(states_grouped);
+
+        delete reused_tree;
+        delete tree;
+        delete state;
+
+        std::cout << "- Reuse random abstraction test done" << std::endl;
+    }
+
+    /*
+     * Test that a CountBucketSet keeps the order of a std::set with AbsQCompare (count ascending, id descending) while its nodes are
+     * transferred between, erased from and reinserted into it, and that the nodes keep track of their bucket positions.
+     */
+    void countBucketSetTest()
+    {
+        auto rng = std::mt19937(42);
+        OGA::OgaSearchStats search_stats = {{1000, "iterations"}};
+        OGA::OgaBehaviorFlags flags{};
+
+        std::vector<OGA::OgaAbstractQStateNode*> abs_nodes;
+        for (int i = 0; i < 20; i++)
+            abs_nodes.push_back(new OGA::OgaAbstractQStateNode(0, search_stats));
+        std::vector<OGA::OgaQStateNode*> q_state_nodes;
+        for (int i = 0; i < 100; i++)
+            q_state_nodes.push_back(new OGA::OgaQStateNode(nullptr, 0, 0, search_stats));
+
+        OGA::AbsQSet abs_q_set;
+        std::set<OGA::OgaAbstractQStateNode*, OGA::AbsQCompare> expected;
+        std::uniform_int_distribution<size_t> abs_dist(0, abs_nodes.size() - 1);
+        std::uniform_int_distribution<size_t> q_dist(0, q_state_nodes.size() - 1);
+
+        bool same_order = true, same_membership = true, ascending_visits = true, erase_absent_ignored = true;
+        for (int step = 0; step < 2000; step++) {
+            if (step % 10 == 9) {
+                // Erase a node, twice to check that erasing a node that is not contained does nothing
+                auto* abs_node = abs_nodes[abs_dist(rng)];
+                expected.erase(abs_node);
+                abs_q_set.erase(abs_node);
+                const size_t size = abs_q_set.size();
+                abs_q_set.erase(abs_node);
+                erase_absent_ignored = erase_absent_ignored && size == abs_q_set.size() && !abs_q_set.contains(abs_node);
+            }
+            else {
+                // Move a ground node to another abstract node, reinserts an erased from node if it still has ground nodes
+                auto* q_state_node = q_state_nodes[q_dist(rng)];
+                auto* from = q_state_node->getAbstractNode();
+                auto* to = abs_nodes[abs_dist(rng)];
+                if (from == to)
+                    continue;
+                if (from != nullptr)
+                    expected.erase(from);
+                expected.erase(to);
+                OGA::OgaAbstractQStateNode::transfer(q_state_node, from, to, abs_q_set, flags);
+                if (from != nullptr && from->getCount() > 0)
+                    expected.insert(from);
+                expected.insert(to);
+            }
+
+            same_order = same_order && abs_q_set.size() == expected.size();
+            size_t k = 0;
+            for (auto* abs_node : expected)
+                same_order = same_order && abs_q_set.at(k++) == abs_node;
+            const auto descending = abs_q_set.descending();
+            same_order = same_order && std::ranges::equal(descending, std::ranges::reverse_view(expected));
+            for (auto* abs_node : abs_nodes)
+                same_membership = same_membership && abs_q_set.contains(abs_node) == expected.contains(abs_node);
+            unsigned last_count = 0;
+            size_t visited = 0;
+            abs_q_set.forEach([&](OGA::OgaAbstractQStateNode* abs_node) {
+                ascending_visits = ascending_visits && last_count <= abs_node->getCount() && expected.contains(abs_node);
+                last_count = abs_node->getCount();
+                visited++;
+            });
+            ascending_visits = ascending_visits && visited == expected.size();
+        }
+        ASSERT_TRUE(same_order);
+        ASSERT_TRUE(same_membership);
+        ASSERT_TRUE(ascending_visits);
+        ASSERT_TRUE(erase_absent_ignored);
+
+        // Removing everything leaves an empty set
+        for (auto* abs_node : abs_nodes)
+            abs_q_set.erase(abs_node);
+        ASSERT_TRUE(abs_q_set.empty());
+        ASSERT_TRUE(abs_q_set.descending().empty());
+
+        for (auto* q_state_node : q_state_nodes)
+            delete q_state_node;
+        for (auto* abs_node : abs_nodes)
+            delete abs_node;
+
+        std::cout << "- Count bucket set test done" << std::endl;
+    }
+
+    /*
+     * Test that the ground node lists stay consistent while state nodes are transferred between abstract nodes: every member knows
+     * its position, the lazy min-id heap finds the member with the smallest id and a removed representant is replaced by it.
+     */
+    void groundNodeListTest()
+    {
+        auto rng = std::mt19937(42);
+        OGA::OgaSearchStats search_stats = {{1000, "iterations"}};
+
+        std::vector<OGA::OgaAbstractStateNode*> abs_nodes;
+        for (int i = 0; i < 6; i++)
+            abs_nodes.push_back(new OGA::OgaAbstractStateNode(0, search_stats));
+        std::vector<OGA::OgaStateNode*> state_nodes;
+        for (int i = 0; i < 60; i++)
+            state_nodes.push_back(new OGA::OgaStateNode(nullptr, 0, search_stats));
+
+        OGA::AbsStateSet abs_state_set;
+        std::map<const OGA::OgaAbstractStateNode*, std::map<unsigned, OGA::OgaStateNode*>> expected_members; //by id
+        std::map<const OGA::OgaAbstractStateNode*, OGA::OgaStateNode*> expected_representants;
+        std::uniform_int_distribution<size_t> abs_dist(0, abs_nodes.size() - 1);
+        std::uniform_int_distribution<size_t> state_dist(0, state_nodes.size() - 1);
+
+        bool same_members = true, positions_valid = true, min_id_found = true, same_representants = true;
+        for (int step = 0; step < 3000; step++) {
+            auto* state_node = state_nodes[state_dist(rng)];
+            auto* from = state_node->getAbstractNode();
+            auto* to = abs_nodes[abs_dist(rng)];
+            if (from == to)
+                continue;
+            if (from != nullptr) {
+                auto& members = expected_members[from];
+                members.erase(state_node->getId());
+                if (expected_representants[from] == state_node)
+                    expected_representants[from] = members.empty() ? nullptr : members.begin()->second;
+            }
+            auto& members = expected_members[to];
+            if (members.empty())
+                expected_representants[to] = state_node;
+            members.emplace(state_node->getId(), state_node);
+            OGA::OgaAbstractStateNode::transfer(state_node, from, to, abs_state_set);
+
+            for (auto* abs_node : abs_nodes) {
+                const auto& ground_nodes = abs_node->getGroundNodes();
+                const auto& expected = expected_members[abs_node];
+                same_members = same_members && ground_nodes.size() == expected.size() && abs_node->getCount() == expected.size();
+                for (auto* ground_node : ground_nodes) {
+                    same_members = same_members && expected.contains(ground_node->getId());
+                    positions_valid = positions_valid && ground_node->getAbstractNode() == abs_node && ground_nodes.contains(ground_node)
+                        && ground_nodes[ground_node->getAbstractPosition()] == ground_node;
+                }
+                auto* min_id_node = ground_nodes.minIdNode();
+                min_id_found = min_id_found && min_id_node == (expected.empty() ? nullptr : expected.begin()->second);
+                same_representants = same_representants && abs_node->getRepresentant() == expected_representants[abs_node];
+            }
+        }
+        ASSERT_TRUE(same_members);
+        ASSERT_TRUE(positions_valid);
+        ASSERT_TRUE(min_id_found);
+        ASSERT_TRUE(same_representants);
+
+        for (auto* state_node : state_nodes)
+            delete state_node;
+        for (auto* abs_node : abs_nodes)
+            delete abs_node;
+
+        std::cout << "- Ground node list test done" << std::endl;
+    }
+
+    /*
+     * Test that the child groups of a state node, used by the selection within an abstract node, follow the children and their
+     * transfers between abstract q nodes: every group holds exactly the children of one abstract node in the order of the children.
+     */
+    void childGroupTest()
+    {
+        auto rng = std::mt19937(42);
+        OGA::OgaSearchStats search_stats = {{1000, "iterations"}};
+        OGA::OgaBehaviorFlags flags{};
+
+        std::vector<OGA::OgaAbstractQStateNode*> abs_nodes;
+        for (int i = 0; i < 4; i++)
+            abs_nodes.push_back(new OGA::OgaAbstractQStateNode(0, search_stats));
+        auto* state_node = new OGA::OgaStateNode(nullptr, 0, search_stats);
+        std::vector<OGA::OgaQStateNode*> q_state_nodes;
+        OGA::AbsQSet abs_q_set;
+        std::uniform_int_distribution<size_t> abs_dist(0, abs_nodes.size() - 1);
+
+        bool same_groups = true;
+        for (int step = 0; step < 500; step++) {
+            if (q_state_nodes.size() < 12 && step % 5 == 0) {
+                // Expand an action, its q node starts in a random abstract node
+                auto* q_state_node = new OGA::OgaQStateNode(nullptr, 0, static_cast<int>(q_state_nodes.size()), search_stats);
+                OGA::OgaAbstractQStateNode::transfer(q_state_node, nullptr, abs_nodes[abs_dist(rng)], abs_q_set, flags);
+                q_state_node->setParent(state_node);
+                state_node->addChild(q_state_node);
+                q_state_nodes.push_back(q_state_node);
+            }
+            else if (!q_state_nodes.empty()) {
+                auto* q_state_node = q_state_nodes[std::uniform_int_distribution<size_t>(0, q_state_nodes.size() - 1)(rng)];
+                auto* from = q_state_node->getAbstractNode();
+                auto* to = abs_nodes[abs_dist(rng)];
+                if (from != to)
+                    OGA::OgaAbstractQStateNode::transfer(q_state_node, from, to, abs_q_set, flags);
+            }
+
+            const auto& children = state_node->getChildren();
+            for (size_t idx = 0; idx < children.size(); idx++) {
+                std::vector<OGA::OgaQStateNode*> expected;
+                for (auto* child : children) {
+                    if (child->getAbstractNode() == children[idx]->getAbstractNode())
+                        expected.push_back(child);
+                }
+                same_groups = same_groups && std::ranges::equal(state_node->getChildGroup(idx), expected);
+            }
+        }
+        ASSERT_TRUE(same_groups);
+        ASSERT_TRUE(state_node->getChildren().size() == 12);
+
+        for (auto* q_state_node : q_state_nodes)
+            delete q_state_node;
+        delete state_node;
+        for (auto* abs_node : abs_nodes)
+            delete abs_node;
+
+        std::cout << "- Child group test done" << std::endl;
+    }
+
 
 }
 
@@ -178,6 +463,10 @@ void OGA::OgaAgent::runTests() {
     simpleGraphTest();
     simpleGroupTerminalTest();
     simpleGroupHorizonTest();
+    reuseRandomAbstractionTest();
+    countBucketSetTest();
+    groundNodeListTest();
+    childGroupTest();
 
     std::cout << "Finished tests for OgaAgent" << std::endl;
 
@@ -5,6 +5,7 @@
 #include <iostream>
 #include <fstream>
 #include <cassert>
+#include <new>
 #include <queue>
 #include <set>
 using namespace std;
@@ -221,10 +222,19 @@ ABS::Gamestate* Model::copyState(ABS::Gamestate* uncasted_state) {
     return new_state;
 }
 
+ABS::Gamestate* Model::copyStateInto(ABS::Gamestate* uncasted_state, void* memory) {
+    auto state = dynamic_cast<Gamestate*>(uncasted_state);
+    return new (memory) Gamestate(*state);
+}
+
 std::vector<int> Model::getActions_(ABS::Gamestate* uncasted_state)  {
     return {0, 1, 2, 3, 4, 5, 6, 7, 8};
 }
 
+void Model::getActionsInto_(ABS::Gamestate* uncasted_state, std::vector<int>& actions)  {
+    actions.assign({0, 1, 2, 3, 4, 5, 6, 7, 8});
+}
+
 
 //Slightly modified from https://github.com/dair-iitd/oga-uct/blob/master/OGA/race/parsing.h
 bool Model::valid_pos(int x, int y) const {
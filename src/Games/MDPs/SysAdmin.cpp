@@ -3,6 +3,7 @@
 #include "../../../include/Games/MDPs/SysAdmin.h"
 #include <iostream>
 #include <cassert>
+#include <new>
 #include <fstream>
 #include <sstream>
 
@@ -139,10 +140,19 @@ ABS::Gamestate* Model::copyState(ABS::Gamestate* uncasted_state) {
     return new_state;
 }
 
+ABS::Gamestate* Model::copyStateInto(ABS::Gamestate* uncasted_state, void* memory) {
+    auto state = dynamic_cast<Gamestate*>(uncasted_state);
+    return new (memory) Gamestate(*state);
+}
+
 std::vector<int> Model::getActions_(ABS::Gamestate* uncasted_state)  {
     return actions;
 }
 
+void Model::getActionsInto_(ABS::Gamestate* uncasted_state, std::vector<int>& available_actions)  {
+    available_actions.assign(actions.begin(), actions.end());
+}
+
 std::pair<int,int> num_neighbors(int i,  std::vector<std::vector<int>>& connections, int& statuses) {
     int num = connections[i].size();
     int num_on = 0;
@@ -1,6 +1,7 @@
 #include "../../../include/Games/TwoPlayerGames/Connect4.h"
 #include <iostream>
 #include <cassert>
+#include <new>
 using namespace std;
 
 using namespace C4;
@@ -56,6 +57,11 @@ ABS::Gamestate* Model::copyState(ABS::Gamestate* uncasted_state) {
     return new_state;
 }
 
+ABS::Gamestate* Model::copyStateInto(ABS::Gamestate* uncasted_state, void* memory) {
+    auto state = dynamic_cast<Gamestate*>(uncasted_state);
+    return new (memory) Gamestate(*state);
+}
+
 std::vector<double> Model::heuristicsValue(ABS::Gamestate* uncasted_state) {
 
     std::vector<int> twos_count = {0,0};
@@ -138,14 +144,19 @@ void Model::printState(ABS::Gamestate* uncasted_state) {
 }
 
 vector<int> Model::getActions_(ABS::Gamestate* uncasted_state) {
-    auto state = dynamic_cast<Gamestate*>(uncasted_state);
     vector<int> actions;
+    getActionsInto_(uncasted_state, actions);
+    return actions;
+}
+
+void Model::getActionsInto_(ABS::Gamestate* uncasted_state, vector<int>& actions) {
+    auto state = dynamic_cast<Gamestate*>(uncasted_state);
+    actions.clear();
     for (int i = 0; i < COLS; i++) {
         if (state->board[0][i] == EMPTY) {
             actions.push_back(i);
         }
     }
-    return actions;
 }
 
 std::pair<std::vector<double>,double> Model::applyAction_(ABS::Gamestate* uncasted_state, int action, std::mt19937& rng, std::vector<std::pair<int,int>>* decision_outcomes) {
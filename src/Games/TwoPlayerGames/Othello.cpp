@@ -1,6 +1,7 @@
 #include "../../../include/Games/TwoPlayerGames/Othello.h"
 #include <iostream>
 #include <cassert>
+#include <new>
 using namespace std;
 
 using namespace OTH;
@@ -86,6 +87,11 @@ ABS::Gamestate* Model::copyState(ABS::Gamestate* uncasted_state) {
     return new_state;
 }
 
+ABS::Gamestate* Model::copyStateInto(ABS::Gamestate* uncasted_state, void* memory) {
+    auto state = dynamic_cast<Gamestate*>(uncasted_state);
+    return new (memory) Gamestate(*state);
+}
+
 int Model::getNumPlayers() {
     return 2;
 }
@@ -76,6 +76,10 @@ ABS::Gamestate* Model::copyState(ABS::Gamestate* uncasted_state) {
     return copy;
 }
 
+ABS::Model* Model::clone() {
+    return new Model(original_model->clone(), true);
+}
+
 std::vector<int> Model::getActions_(ABS::Gamestate* uncasted_state)  {
     return original_model->getActions(dynamic_cast<Gamestate*>(uncasted_state)->ground_state);
 }
@@ -1,7 +1,9 @@
 #include "../../../include/Games/Wrapper/FiniteHorizon.h"
 
 #include <cassert>
+#include <cstddef>
 #include <fstream>
+#include <new>
 
 using namespace FINITEH;
 
@@ -88,10 +90,40 @@ ABS::Gamestate* Model::copyState(ABS::Gamestate* uncasted_state) {
     return copy;
 }
 
+// The ground state is placed behind the wrapper state
+static size_t groundStateOffset() {
+    return (sizeof(Gamestate) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+}
+
+size_t Model::getStateSize() {
+    const size_t ground_state_size = original_model->getStateSize();
+    return ground_state_size == 0? 0 : groundStateOffset() + ground_state_size;
+}
+
+ABS::Gamestate* Model::copyStateInto(ABS::Gamestate* uncasted_state, void* memory) {
+    auto state = dynamic_cast<Gamestate*>(uncasted_state);
+    auto copy = new (memory) Gamestate();
+    copy->ground_state = original_model->copyStateInto(state->ground_state, static_cast<char*>(memory) + groundStateOffset());
+    copy->ground_state_in_place = true;
+    copy->turn = state->turn;
+    copy->terminal = state->terminal;
+    copy->remaining_steps = state->remaining_steps;
+    copy->free_ground_state = state->free_ground_state;
+    return copy;
+}
+
+ABS::Model* Model::clone() {
+    return new Model(original_model->clone(), horizon_length, true);
+}
+
 std::vector<int> Model::getActions_(ABS::Gamestate* uncasted_state)  {
     return original_model->getActions(dynamic_cast<Gamestate*>(uncasted_state)->ground_state);
 }
 
+void Model::getActionsInto_(ABS::Gamestate* uncasted_state, std::vector<int>& actions)  {
+    original_model->getActions(dynamic_cast<Gamestate*>(uncasted_state)->ground_state, actions);
+}
+
 std::pair<std::vector<double>,double> Model::applyAction_(ABS::Gamestate* uncasted_state, int action, std::mt19937& rng, std::vector<std::pair<int,int>>* decision_outcomes) {
     assert (dynamic_cast<Gamestate*>(uncasted_state)->remaining_steps > 0);
     auto casted_state = dynamic_cast<Gamestate*>(uncasted_state);
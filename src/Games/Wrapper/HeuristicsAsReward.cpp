@@ -38,6 +38,10 @@ ABS::Gamestate* Model::copyState(ABS::Gamestate* uncasted_state) {
     return original_model->copyState(uncasted_state);
 }
 
+ABS::Model* Model::clone() {
+    return new Model(original_model->clone(), true, const_reward);
+}
+
 std::vector<int> Model::getActions_(ABS::Gamestate* uncasted_state)  {
     return original_model->getActions(uncasted_state);
 }
@@ -1,6 +1,7 @@
 #include "../../../include/Games/Wrapper/ScriptedStart.h"
 
 #include <cassert>
+#include <algorithm>
 #include <fstream>
 
 using namespace SCRIPTEDSTART;
@@ -0,0 +1,188 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+#include "../include/Agents/Agent.h"
+#include "../include/Games/Wrapper/FiniteHorizon.h"
+#include "../include/Utils/AgentMaker.h"
+#include "../include/Utils/Argparse.h"
+#include "../include/Utils/MemoryAnalysis.h"
+#include "../include/Utils/ModelMaker.h"
+
+/*
+ * Benchmark of the OGA abstraction engine on a fixed matrix of environments, q abstraction settings and iteration budgets.
+ * Every configuration plays one episode per seed and reports its speed, the share of the search spent in abstraction updates
+ * (from the OGA telemetry, which this target is always compiled with), the peak RSS and a checksum over all actions and rewards.
+ * As iteration budgets are deterministic, the checksums must not change when the engine is only optimized.
+ */
+
+struct BenchmarkEnvironment {
+    std::string name;
+    std::string model;
+    std::vector<std::string> margs;
+};
+
+struct BenchmarkAbstraction {
+    std::string name;
+    std::vector<std::string> aargs;
+};
+
+static const std::vector<BenchmarkEnvironment> ENVIRONMENTS = {
+    {"navigation", "navigation", {"map=1_IPPC.txt"}},
+    {"sysadmin", "sa", {"map=1_IPPC.txt"}},
+    {"elevators", "ele", {"map=1_IPPC.txt"}},
+    {"traffic", "tr", {"map=1_IPPC.txt"}},
+    {"gameoflife", "gol", {"map=1_IPPC.txt"}},
+    {"racetrack", "rt", {"map=ring-1.track"}},
+};
+
+static const std::vector<BenchmarkAbstraction> ABSTRACTIONS = {
+    {"exact", {}},
+    {"eps", {"eps_a=0.5", "eps_t=0.5"}},
+    {"alpha", {"alpha=0.5"}},
+    {"random", {"q_abs_alg=random", "abs_alg=random"}},
+};
+
+static const std::vector<int> BUDGETS = {100, 1000};
+
+// FNV-1a over the raw bytes of a value
+template <class T>
+static void checksumAdd(uint64_t& checksum, const T& value) {
+    unsigned char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    for (const unsigned char byte : bytes) {
+        checksum ^= byte;
+        checksum *= 0x100000001b3ULL;
+    }
+}
+
+// Sums the cycle columns (tree policy, rollout, backup, abstraction update) of a telemetry CSV file
+static std::pair<double, double> readTelemetryCycles(const std::string& path) {
+    std::ifstream file(path);
+    std::string line;
+    std::getline(file, line); //header
+    double total_cycles = 0, abstraction_cycles = 0;
+    while (std::getline(file, line)) {
+        std::stringstream ss(line);
+        std::string field;
+        for (int column = 0; std::getline(ss, field, ';') && column < 6; column++) {
+            if (column < 2)
+                continue;
+            total_cycles += std::stod(field);
+            if (column == 5)
+                abstraction_cycles += std::stod(field);
+        }
+    }
+    return {total_cycles, abstraction_cycles};
+}
+
+int main(const int argc, char **argv) {
+
+    argparse::ArgumentParser program("OgaBenchmark");
+
+    program.add_argument("-s", "--seeds")
+        .help("Number of seeds (episodes) per configuration")
+        .action([](const std::string &value) { return std::stoi(value); })
+        .default_value(3);
+
+    program.add_argument("-d", "--decisions")
+        .help("Number of decisions per episode")
+        .action([](const std::string &value) { return std::stoi(value); })
+        .default_value(10);
+
+    program.add_argument("-p_horizon", "--p_horizon")
+        .help("Planning horizon")
+        .action([](const std::string &value) { return std::stoi(value); })
+        .default_value(10);
+
+    program.add_argument("-f", "--filter")
+        .help("Only run configurations whose environment name contains this string")
+        .default_value(std::string(""));
+
+    program.add_argument("-omit_times", "--omit_times")
+        .help("Only output the checksums, e.g. to compare two builds for bit-exactness")
+        .default_value(false)
+        .implicit_value(true);
+
+    program.parse_args(argc, argv);
+
+    const int seeds = program.get<int>("--seeds");
+    const int decisions = program.get<int>("--decisions");
+    const int planning_horizon = program.get<int>("--p_horizon");
+    const auto filter = program.get<std::string>("--filter");
+    const bool omit_times = program.get<bool>("--omit_times");
+    const std::string telemetry_path = (std::filesystem::temp_directory_path() / ("oga_benchmark_" + std::to_string(std::chrono::system_clock::now().time_since_epoch().count()) + ".csv")).string();
+
+    if (omit_times)
+        std::cout << "environment;abstraction;iterations;checksum" << std::endl;
+    else
+        std::cout << "environment;abstraction;iterations;decisions;seconds;iterations_per_s;forward_calls_per_s;abs_update_share;peak_rss_mb;checksum" << std::endl;
+
+    uint64_t total_checksum = 0xcbf29ce484222325ULL;
+    for (const auto& environment : ENVIRONMENTS) {
+        if (environment.name.find(filter) == std::string::npos)
+            continue;
+        for (const auto& abstraction : ABSTRACTIONS) {
+            for (const int budget : BUDGETS) {
+
+                auto aargs = abstraction.aargs;
+                aargs.push_back("iterations=" + std::to_string(budget));
+                aargs.push_back("telemetry_file=" + telemetry_path);
+                std::remove(telemetry_path.c_str());
+
+                auto* ground_model = getModel(environment.model, environment.margs);
+                auto model = FINITEH::Model(ground_model, decisions, true);
+                Agent* agent = getAgent("oga", aargs);
+
+                MEMORY::ResetPeakMemory();
+                uint64_t checksum = 0xcbf29ce484222325ULL;
+                int total_decisions = 0;
+                double seconds = 0;
+                long forward_calls = 0;
+                for (int seed = 0; seed < seeds; seed++) {
+                    std::mt19937 rng(seed);
+                    auto* state = dynamic_cast<FINITEH::Gamestate*>(model.getInitialState(rng));
+                    while (!state->terminal) {
+                        const size_t remaining_steps = state->remaining_steps;
+                        state->remaining_steps = std::min(remaining_steps, static_cast<size_t>(planning_horizon));
+                        const long forward_calls_before = model.getForwardCalls();
+                        const auto start = std::chrono::high_resolution_clock::now();
+                        const int action = agent->getAction(&model, state, rng);
+                        seconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+                        forward_calls += model.getForwardCalls() - forward_calls_before;
+                        state->remaining_steps = remaining_steps;
+                        total_decisions++;
+
+                        const auto [rewards, probability] = model.applyAction(state, action, rng, nullptr);
+                        checksumAdd(checksum, action);
+                        for (const double reward : rewards)
+                            checksumAdd(checksum, reward);
+                    }
+                    delete state;
+                }
+                checksumAdd(total_checksum, checksum);
+
+                if (omit_times) {
+                    std::cout << environment.name << ";" << abstraction.name << ";" << budget << ";" << std::hex << checksum << std::dec << std::endl;
+                } else {
+                    const auto [total_cycles, abstraction_cycles] = readTelemetryCycles(telemetry_path);
+                    std::cout << environment.name << ";" << abstraction.name << ";" << budget << ";" << total_decisions << ";" << seconds << ";"
+                              << static_cast<double>(budget) * total_decisions / seconds << ";" << forward_calls / seconds << ";"
+                              << (total_cycles > 0 ? abstraction_cycles / total_cycles : 0) << ";" << MEMORY::GetPeakMemory() << ";"
+                              << std::hex << checksum << std::dec << std::endl;
+                }
+
+                delete agent;
+            }
+        }
+    }
+    std::remove(telemetry_path.c_str());
+
+    std::cout << "total;;;" << (omit_times ? "" : ";;;;;;") << std::hex << total_checksum << std::dec << std::endl;
+    return 0;
+}
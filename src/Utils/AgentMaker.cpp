@@ -49,7 +49,7 @@ Agent* getAgent(const std::string& agent_type, const std::vector<std::string>& a
         assert (agent_args.contains("iterations"));
         if(agent_args.contains("wirsa"))
             assert (agent_args.contains("a") && agent_args.contains("b"));
-        acceptable_args = {"iterations", "rollout_length", "discount", "num_rollouts", "dag", "dynamic_exp_factor", "expfacs", "wirsa", "a", "b", "puct", "max_backup"};
+        acceptable_args = {"iterations", "rollout_length", "discount", "num_rollouts", "dag", "dynamic_exp_factor", "expfacs", "wirsa", "a", "b", "puct", "max_backup", "threads", "leaf_parallel", "shared_tree", "virtual_loss"};
 
         int iterations = std::stoi(agent_args["iterations"]);
         int rollout_length = agent_args.find("rollout_length") == agent_args.end() ? -1 : std::stoi(agent_args["rollout_length"]);
@@ -71,6 +71,10 @@ Agent* getAgent(const std::string& agent_type, const std::vector<std::string>& a
         }
         bool max_backup = agent_args.find("max_backup") == agent_args.end() ? false : std::stoi(agent_args["max_backup"]);
         bool puct = agent_args.find("puct") == agent_args.end() ? false : std::stoi(agent_args["puct"]);
+        int threads = agent_args.find("threads") == agent_args.end() ? 1 : std::stoi(agent_args["threads"]);
+        bool leaf_parallel = agent_args.find("leaf_parallel") == agent_args.end() ? false : std::stoi(agent_args["leaf_parallel"]);
+        bool shared_tree = agent_args.find("shared_tree") == agent_args.end() ? false : std::stoi(agent_args["shared_tree"]);
+        double virtual_loss = agent_args.find("virtual_loss") == agent_args.end() ? 1.0 : std::stod(agent_args["virtual_loss"]);
 
         auto args = Mcts::MctsArgs{.budget = {iterations, "iterations"}, .exploration_parameters = expfac, .discount = discount,
             .num_rollouts = num_rollouts,
@@ -79,7 +83,11 @@ Agent* getAgent(const std::string& agent_type, const std::vector<std::string>& a
             .dynamic_exploration_factor=dynamic_exp_factor,
             .max_backup = max_backup,
             .wirsa = wirsa,
-            .a=a,.b=b, .puct = puct};
+            .a=a,.b=b, .puct = puct,
+            .threads = threads,
+            .leaf_parallel = leaf_parallel,
+            .shared_tree = shared_tree,
+            .virtual_loss = virtual_loss};
         agent =  new Mcts::MctsAgent(args);
     }
      else if (agent_type == "oga") {
@@ -87,7 +95,8 @@ Agent* getAgent(const std::string& agent_type, const std::vector<std::string>& a
         acceptable_args = {"iterations", "discount", "expfac", "K","group_terminal_states", "group_partially_expanded_states", "equiv_chance",
             "consider_missing_outcomes", "q_abs_alg", "track_statistics",
             "partial_expansion_group_threshold", "ignore_partially_expanded_states", "eps_a", "eps_t", "abs_alg", "in_abs_policy", "alpha",
-           "num_rollouts", "rollout_length"};
+           "num_rollouts", "rollout_length", "threads", "shared_tree", "virtual_loss", "abs_update_interval", "abs_update_threshold", "reuse_tree", "rollout_threads", "max_tree_nodes",
+           "telemetry_file"};
 
         int iterations = std::stoi(agent_args["iterations"]);
         double discount = agent_args.find("discount") == agent_args.end() ? 1.0 : std::stod(agent_args["discount"]);
@@ -100,6 +109,14 @@ Agent* getAgent(const std::string& agent_type, const std::vector<std::string>& a
         double eps_t = agent_args.find("eps_t") == agent_args.end() ? 0.0 : std::stod(agent_args["eps_t"]);
         int num_rollouts = agent_args.find("num_rollouts") == agent_args.end() ? 1 : std::stoi(agent_args["num_rollouts"]);
         int rollout_length = agent_args.find("rollout_length") == agent_args.end() ? -1 : std::stoi(agent_args["rollout_length"]);
+        int threads = agent_args.find("threads") == agent_args.end() ? 1 : std::stoi(agent_args["threads"]);
+        bool shared_tree = agent_args.find("shared_tree") == agent_args.end() ? false : std::stoi(agent_args["shared_tree"]);
+        double virtual_loss = agent_args.find("virtual_loss") == agent_args.end() ? 1.0 : std::stod(agent_args["virtual_loss"]);
+        int abs_update_interval = agent_args.find("abs_update_interval") == agent_args.end() ? 1 : std::stoi(agent_args["abs_update_interval"]);
+        unsigned abs_update_threshold = agent_args.find("abs_update_threshold") == agent_args.end() ? 0 : std::stoi(agent_args["abs_update_threshold"]);
+        int rollout_threads = agent_args.find("rollout_threads") == agent_args.end() ? 1 : std::stoi(agent_args["rollout_threads"]);
+        bool reuse_tree = agent_args.find("reuse_tree") == agent_args.end() ? false : std::stoi(agent_args["reuse_tree"]);
+        size_t max_tree_nodes = agent_args.find("max_tree_nodes") == agent_args.end() ? 0 : std::stoul(agent_args["max_tree_nodes"]);
         double equiv_chance = agent_args.find("equiv_chance") == agent_args.end() ? 0.1 : std::stod(agent_args["equiv_chance"]);
         double alpha = agent_args.find("alpha") == agent_args.end() ? 0.0 : std::stod(agent_args["alpha"]);
         bool consider_missing_outcomes = agent_args.find("consider_missing_outcomes") == agent_args.end() ? false : std::stoi(agent_args["consider_missing_outcomes"]);
@@ -108,6 +125,7 @@ Agent* getAgent(const std::string& agent_type, const std::vector<std::string>& a
          std::string q_abs_alg = agent_args.find("q_abs_alg") == agent_args.end() ? "eps" : agent_args["q_abs_alg"];
          std::string in_abs_policy = agent_args.find("in_abs_policy") == agent_args.end() ? "random" : agent_args["in_abs_policy"];
         std::string abs_alg = agent_args.find("abs_alg") == agent_args.end() ? "asap" : agent_args["abs_alg"];
+        std::string telemetry_file = agent_args.find("telemetry_file") == agent_args.end() ? "" : agent_args["telemetry_file"];
 
         auto args = OGA::OgaArgs{
             .budget = {iterations, "iterations"},
@@ -116,6 +134,14 @@ Agent* getAgent(const std::string& agent_type, const std::vector<std::string>& a
             .discount = discount,
             .num_rollouts = num_rollouts,
             .rollout_length = rollout_length,
+            .rollout_threads = rollout_threads,
+            .threads = threads,
+            .shared_tree = shared_tree,
+            .virtual_loss = virtual_loss,
+            .abs_update_interval = abs_update_interval,
+            .abs_update_threshold = abs_update_threshold,
+            .reuse_tree = reuse_tree,
+            .max_tree_nodes = max_tree_nodes,
             .behavior_flags = {
                 .group_terminal_states=group_terminal_states,
                 .group_partially_expanded_states=group_partially_expanded_states,
@@ -130,6 +156,7 @@ Agent* getAgent(const std::string& agent_type, const std::vector<std::string>& a
             },
             .in_abs_policy = in_abs_policy,
             .track_statistics = track_statistics,
+            .telemetry_file = telemetry_file,
         };
         agent =  new OGA::OgaAgent(args);
     }else{
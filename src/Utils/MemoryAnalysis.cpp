@@ -1,35 +1,82 @@
 #include "../../include/Utils/MemoryAnalysis.h"
 
+#include <fstream>
 #include <iostream>
+#include <string>
 #ifdef _WIN32
 #include <windows.h>
 #include <psapi.h>
 #else
 #include <sys/resource.h>
-#include <unistd.h>
 #endif
 
 
 namespace MEMORY
 {
 
-    void PrintUsedMemory()
+    #ifndef _WIN32
+    // Reads a field such as "VmRSS:    1234 kB" of /proc/self/status, which only exists on Linux
+    static double readStatusField(const std::string& field)
+    {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line)) {
+            if (line.starts_with(field + ":"))
+                return std::stod(line.substr(field.size() + 1)) / 1024.0;
+        }
+        return -1;
+    }
+    #endif
+
+    double GetUsedMemory()
     {
         #ifdef _WIN32
         PROCESS_MEMORY_COUNTERS pmc;
-        if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) {
-            std::cout << "Used Memory: " << pmc.WorkingSetSize / (1024.0 * 1024.0) << " MB" << std::endl;
-        } else {
-            std::cerr << "Failed to retrieve used memory information." << std::endl;
-        }
+        if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+            return pmc.WorkingSetSize / (1024.0 * 1024.0);
+        return -1;
+        #else
+        return readStatusField("VmRSS");
+        #endif
+    }
+
+    double GetPeakMemory()
+    {
+        #ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS pmc;
+        if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+            return pmc.PeakWorkingSetSize / (1024.0 * 1024.0);
+        return -1;
         #else
+        if (const double peak = readStatusField("VmHWM"); peak >= 0)
+            return peak;
         struct rusage usage;
-        if (getrusage(RUSAGE_SELF, &usage) == 0) {
-            std::cout << "Used Memory: " << usage.ru_maxrss / 1024.0 << " MB" << std::endl;
-        } else {
+        if (getrusage(RUSAGE_SELF, &usage) == 0)
+            return usage.ru_maxrss / 1024.0;
+        return -1;
+        #endif
+    }
+
+    void ResetPeakMemory()
+    {
+        #ifndef _WIN32
+        std::ofstream clear_refs("/proc/self/clear_refs");
+        clear_refs << "5";
+        #endif
+    }
+
+    void PrintUsedMemory()
+    {
+        const double used = GetUsedMemory();
+        const double peak = GetPeakMemory();
+        if (used < 0 && peak < 0) {
             std::cerr << "Failed to retrieve used memory information." << std::endl;
+            return;
         }
-        #endif
+        if (used >= 0)
+            std::cout << "Used Memory: " << used << " MB" << std::endl;
+        if (peak >= 0)
+            std::cout << "Peak Memory: " << peak << " MB" << std::endl;
     }
 
-}
\ No newline at end of file
+}
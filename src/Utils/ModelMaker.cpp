@@ -47,6 +47,7 @@
 #include "../../include/Games/MDPs/TravellingSalesPerson.h"
 #include "../../include/Games/MDPs/SupplyChain.h"
 
+#include <algorithm>
 #include <map>
 #include <set>
 #include <bits/ranges_algo.h>
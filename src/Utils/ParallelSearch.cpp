@@ -0,0 +1,87 @@
+#include "../../include/Utils/ParallelSearch.h"
+
+#include <cassert>
+#include <thread>
+
+namespace PARALLEL
+{
+
+    ModelClones::ModelClones(ABS::Model* original, const int num, const bool first_is_original) : original(original), first_is_original(first_is_original)
+    {
+        for (int i = 0; i < num; i++) {
+            models.push_back(i == 0 && first_is_original? original : original->clone());
+            credited_forward_calls.push_back(models.back()->getForwardCalls());
+        }
+    }
+
+    ModelClones::~ModelClones()
+    {
+        creditForwardCalls();
+        for (int i = first_is_original? 1 : 0; i < size(); i++)
+            delete models[i];
+    }
+
+    void ModelClones::creditForwardCalls()
+    {
+        for (int i = first_is_original? 1 : 0; i < size(); i++) {
+            const long forward_calls = models[i]->getForwardCalls();
+            original->addForwardCalls(forward_calls - credited_forward_calls[i]);
+            credited_forward_calls[i] = forward_calls;
+        }
+    }
+
+    ABS::Gamestate* RolloutScratch::copyState(ABS::Model* model, const ABS::Gamestate* state)
+    {
+        auto* uncasted_state = const_cast<ABS::Gamestate*>(state); //Models take mutable states, but copying does not change them
+        const size_t size = model->getStateSize();
+        state_in_buffer = size > 0;
+        if (!state_in_buffer)
+            return model->copyState(uncasted_state);
+        buffer.resize(std::max(buffer.size(), (size + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t)));
+        return model->copyStateInto(uncasted_state, buffer.data());
+    }
+
+    void RolloutScratch::release(ABS::Gamestate* rollout_state)
+    {
+        if (state_in_buffer)
+            rollout_state->~Gamestate();
+        else
+            delete rollout_state;
+    }
+
+    std::vector<std::mt19937> forkRngs(std::mt19937& rng, const int num)
+    {
+        std::vector<std::mt19937> rngs;
+        for (int i = 0; i < num; i++)
+            rngs.emplace_back(rng());
+        return rngs;
+    }
+
+    void runWorkers(const int num, const std::function<void(int worker)>& work)
+    {
+        std::vector<std::thread> workers;
+        for (int i = 0; i < num; i++)
+            workers.emplace_back(work, i);
+        for (auto& worker : workers)
+            worker.join();
+    }
+
+    void RolloutPool::playRollouts(const int num_rollouts, const int num_players, std::mt19937& rng, const PlayRollout& play, double* reward_sum)
+    {
+        assert (models != nullptr);
+        seeds.resize(num_rollouts);
+        for (auto& seed : seeds)
+            seed = rng();
+        rewards.assign(static_cast<size_t>(num_rollouts) * num_players, 0.0);
+        pool.parallelFor(num_rollouts, [&](const int i, const int worker) {
+            std::mt19937 rollout_rng(seeds[i]);
+            play((*models)[worker], rollout_rng, &rewards[static_cast<size_t>(i) * num_players], scratches[worker]);
+        });
+        for (int i = 0; i < num_rollouts; i++) {
+            for (int j = 0; j < num_players; j++)
+                reward_sum[j] += rewards[static_cast<size_t>(i) * num_players + j];
+        }
+        models->creditForwardCalls(); //Counted after every leaf, as forward call budgets are checked after every iteration
+    }
+
+}
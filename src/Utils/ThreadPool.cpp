@@ -0,0 +1,79 @@
+#include "../../include/Utils/ThreadPool.h"
+
+#include <cassert>
+#include <utility>
+
+namespace PARALLEL
+{
+
+    ThreadPool::ThreadPool(const int num_threads)
+    {
+        assert (num_threads > 0);
+        for (int i = 0; i < num_threads; i++)
+            workers.emplace_back(&ThreadPool::work, this, i);
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard lock(mutex);
+            stop = true;
+        }
+        work_available.notify_all();
+        for (auto& worker : workers)
+            worker.join();
+    }
+
+    void ThreadPool::parallelFor(const int n, const std::function<void(int task, int worker)>& task)
+    {
+        if (n <= 0)
+            return;
+
+        std::unique_lock lock(mutex);
+        assert (this->task == nullptr);
+        this->task = &task;
+        num_tasks = n;
+        next_task = 0;
+        unfinished_tasks = n;
+        generation++;
+        work_available.notify_all();
+
+        work_done.wait(lock, [this]{ return unfinished_tasks == 0; });
+        this->task = nullptr;
+        if (error != nullptr)
+            std::rethrow_exception(std::exchange(error, nullptr));
+    }
+
+    void ThreadPool::work(const int worker)
+    {
+        unsigned long seen_generation = 0;
+        std::unique_lock lock(mutex);
+        while (true) {
+            work_available.wait(lock, [&]{ return stop || (generation != seen_generation && next_task < num_tasks); });
+            if (stop)
+                return;
+            seen_generation = generation;
+
+            while (next_task < num_tasks) {
+                const int i = next_task++;
+                const auto* current_task = task;
+                lock.unlock();
+                std::exception_ptr task_error = nullptr;
+                try {
+                    (*current_task)(i, worker);
+                } catch (...) {
+                    task_error = std::current_exception();
+                }
+                lock.lock();
+                if (task_error != nullptr && error == nullptr) {
+                    error = task_error;
+                    unfinished_tasks -= num_tasks - next_task; //Skip the remaining tasks
+                    next_task = num_tasks;
+                }
+                if (--unfinished_tasks == 0)
+                    work_done.notify_one();
+            }
+        }
+    }
+
+}